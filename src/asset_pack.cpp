@@ -0,0 +1,144 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "asset_pack.hpp"
+
+static const char MAGIC[4] = {'A', 'P', 'K', '1'};
+static const uint32_t VERSION = 1;
+
+struct AssetPackHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t stride;
+    uint64_t payload_offset;
+};
+
+static_assert(sizeof(AssetPackHeader) == 32, "AssetPackHeader must be 32 bytes");
+
+static int bytesPerPixel(uint32_t format)
+{
+    switch (format) {
+        case AssetPack::GRAY8:
+            return 1;
+        default:
+            throw std::runtime_error("Unknown asset pack format " + std::to_string(format));
+    }
+}
+
+AssetPack AssetPack::open(const std::string &filename)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        throw std::runtime_error("Can't open asset pack " + filename);
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Can't stat asset pack " + filename);
+    }
+
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Can't mmap asset pack " + filename);
+    }
+
+    AssetPack pack;
+    pack.mapping_ = mapping;
+    pack.mapping_size_ = st.st_size;
+    pack.parse(mapping, st.st_size);
+
+    return pack;
+}
+
+AssetPack AssetPack::fromMemory(const void *data, size_t size)
+{
+    AssetPack pack;
+    pack.parse(data, size);
+
+    return pack;
+}
+
+AssetPack::AssetPack(AssetPack &&other) :
+    width_(other.width_),
+    height_(other.height_),
+    format_(other.format_),
+    stride_(other.stride_),
+    data_(other.data_),
+    mapping_(other.mapping_),
+    mapping_size_(other.mapping_size_)
+{
+    other.data_ = nullptr;
+    other.mapping_ = nullptr;
+    other.mapping_size_ = 0;
+}
+
+AssetPack::~AssetPack()
+{
+    if (mapping_) {
+        munmap(mapping_, mapping_size_);
+    }
+}
+
+void AssetPack::parse(const void *base, size_t size)
+{
+    AssetPackHeader header;
+
+    if (size < sizeof(header)) {
+        throw std::runtime_error("Asset pack too small");
+    }
+
+    std::memcpy(&header, base, sizeof(header));
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+        throw std::runtime_error("Not a version 1 asset pack");
+    }
+
+    uint64_t row_size = static_cast<uint64_t>(header.width) * bytesPerPixel(header.format);
+    uint64_t payload_size = static_cast<uint64_t>(header.stride) * header.height;
+
+    if (header.stride < row_size || header.payload_offset > size || payload_size > size - header.payload_offset) {
+        throw std::runtime_error("Asset pack header doesn't match its size");
+    }
+
+    width_ = header.width;
+    height_ = header.height;
+    format_ = static_cast<Format>(header.format);
+    stride_ = header.stride;
+    data_ = static_cast<const unsigned char*>(base) + header.payload_offset;
+}
+
+void writeAssetPack(const std::string &filename, int width, int height, AssetPack::Format format, int stride, const unsigned char *data)
+{
+    AssetPackHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.width = width;
+    header.height = height;
+    header.format = format;
+    header.stride = stride;
+    header.payload_offset = sizeof(header);
+
+    std::ofstream file(filename, std::ios::binary);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(data), static_cast<size_t>(stride) * height);
+
+    if (!file) {
+        throw std::runtime_error("Failed writing asset pack " + filename);
+    }
+}
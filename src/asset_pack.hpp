@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Raw image asset: a 32 byte header followed by the pixels, mapped straight into memory.
+//
+// Header, little-endian:
+//   char     magic[4]        "APK1"
+//   uint32_t version         1
+//   uint32_t width
+//   uint32_t height
+//   uint32_t format          AssetPack::Format
+//   uint32_t stride          bytes per row
+//   uint64_t payload_offset  from the start of the file
+class AssetPack
+{
+public:
+    enum Format
+    {
+        GRAY8 = 1
+    };
+
+    // mmap a pack from disk
+    static AssetPack open(const std::string &filename);
+
+    // Use a pack already in memory, eg. embedded with .incbin. The memory is not owned.
+    static AssetPack fromMemory(const void *data, size_t size);
+
+    AssetPack(AssetPack &&other);
+    ~AssetPack();
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    Format format() const { return format_; }
+    int stride() const { return stride_; }
+    const unsigned char *data() const { return data_; }
+
+private:
+    AssetPack() {}
+
+    void parse(const void *base, size_t size);
+
+    int width_ = 0;
+    int height_ = 0;
+    Format format_ = GRAY8;
+    int stride_ = 0;
+    const unsigned char *data_ = nullptr;
+
+    // set when the pack is mmapped
+    void *mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+};
+
+// Write a pack, data has height rows of stride bytes
+void writeAssetPack(const std::string &filename, int width, int height, AssetPack::Format format, int stride, const unsigned char *data);
@@ -0,0 +1,360 @@
+#include <GL/glew.h>
+
+#include <glm/mat4x4.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "opengl_helper.hpp"
+#include "blocking_queue.hpp"
+#include "calibration_io.hpp"
+#include "camera_model.hpp"
+#include "frame_readback.hpp"
+#include "frame_uploader.hpp"
+#include "image_io.hpp"
+#include "mesh.hpp"
+#include "overlay_renderer.hpp"
+#include "pose_io.hpp"
+#include "render_context.hpp"
+#include "software_rasterizer.hpp"
+
+// Renders the cuboid overlay onto a sequence of recorded frames as fast as possible.
+// Decoding, GL upload/render/readback and writing run on their own threads connected by
+// bounded queues, so throughput approaches that of the slowest stage. Readback goes through
+// a PBO ring so the render thread doesn't wait for each frame to come back.
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct DecodedFrame
+{
+    size_t index;
+    Image image;
+};
+
+struct RenderedFrame
+{
+    size_t index;
+    Image image; // RGBA
+    bool bottom_up; // straight out of glReadPixels
+};
+
+static void usage(const char *argv0)
+{
+    std::cerr << "usage: " << argv0 << " <frame dir> <poses.csv|poses.yml|poses.xml|poses.bin> <output dir>\n"
+        "    [--backend egl|osmesa|glfw|software] [--intrinsics fx,fy,cx,cy[,skew]] [--calibration FILE]\n"
+        "    [--distortion none|undistort|geometry] [--board width,height,depth] [--depth-range near,far] [--reversed-z]\n"
+        "    [--pose-cache DIR]\n"
+        "\n"
+        "Frames are 8-bit binary PGM files, processed in name order, one pose per frame.\n"
+        "--calibration reads an OpenCV calibration YAML/XML file instead of --intrinsics, scaled to\n"
+        "the frame size. Its distortion is applied to the overlay, except by the software backend.\n"
+        "--distortion none draws as if the frames were undistorted, undistort remaps the frames on the\n"
+        "GPU and geometry distorts the overlay instead, the default with a distorted calibration.\n"
+        "--pose-cache keeps the parsed poses of YAML/XML pose files as binary records in DIR.\n"
+        "Composited frames are written to the output dir as PPM.\n"
+        "The software backend renders on the CPU with SoftwareRasterizer, no GPU needed.\n";
+}
+
+static bool parseFloats(const char *str, float *values, int n)
+{
+    for (int i = 0; i < n; i++) {
+        char *end;
+        values[i] = std::strtof(str, &end);
+
+        if (end == str || (i < n - 1 && *end != ',') || (i == n - 1 && *end != '\0')) {
+            return false;
+        }
+
+        str = end + 1;
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    std::string frame_dir = argv[1];
+    std::string pose_file = argv[2];
+    std::string output_dir = argv[3];
+    std::string backend = "egl";
+    std::string calibration_file;
+    std::string pose_cache_dir;
+
+    // defaults are the calibration of opencv/samples/data/left*.jpg, units in meters
+    float intrinsics[5] = {5.3646257838368388e+02, 5.3641495077527384e+02, 3.4236864003069093e+02, 2.3554895272852343e+02, 0};
+    float board[3] = {8 * 0.02, 5 * 0.02, 0.07};
+    float depth_range[2] = {0.01, 10};
+    DepthMode depth_mode = DepthMode::Standard;
+    DistortionMode distortion_mode = DistortionMode::None;
+    bool distortion_set = false;
+
+    for (int i = 4; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--backend") == 0 && has_value) {
+            backend = argv[++i];
+        } else if (std::strcmp(argv[i], "--intrinsics") == 0 && has_value &&
+                (parseFloats(argv[i + 1], intrinsics, 5) || parseFloats(argv[i + 1], intrinsics, 4))) {
+            i++;
+        } else if (std::strcmp(argv[i], "--calibration") == 0 && has_value) {
+            calibration_file = argv[++i];
+        } else if (std::strcmp(argv[i], "--board") == 0 && has_value && parseFloats(argv[i + 1], board, 3)) {
+            i++;
+        } else if (std::strcmp(argv[i], "--depth-range") == 0 && has_value && parseFloats(argv[i + 1], depth_range, 2)) {
+            i++;
+        } else if (std::strcmp(argv[i], "--distortion") == 0 && has_value && std::strcmp(argv[i + 1], "none") == 0) {
+            distortion_mode = DistortionMode::None;
+            distortion_set = true;
+            i++;
+        } else if (std::strcmp(argv[i], "--distortion") == 0 && has_value && std::strcmp(argv[i + 1], "undistort") == 0) {
+            distortion_mode = DistortionMode::UndistortImage;
+            distortion_set = true;
+            i++;
+        } else if (std::strcmp(argv[i], "--distortion") == 0 && has_value && std::strcmp(argv[i + 1], "geometry") == 0) {
+            distortion_mode = DistortionMode::DistortGeometry;
+            distortion_set = true;
+            i++;
+        } else if (std::strcmp(argv[i], "--reversed-z") == 0) {
+            depth_mode = DepthMode::ReversedZ;
+        } else if (std::strcmp(argv[i], "--pose-cache") == 0 && has_value) {
+            pose_cache_dir = argv[++i];
+        } else {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (!pose_cache_dir.empty()) {
+        setPoseCache(pose_cache_dir);
+    }
+
+    std::vector<std::string> frames;
+    std::vector<glm::mat4> poses;
+    Image first;
+    CameraModel camera;
+
+    try {
+        frames = listFiles(frame_dir, ".pgm");
+        poses = loadPoses(pose_file);
+
+        if (frames.empty()) {
+            throw std::runtime_error("No .pgm frames in " + frame_dir);
+        }
+
+        if (poses.size() != frames.size()) {
+            throw std::runtime_error(std::to_string(frames.size()) + " frames but " + std::to_string(poses.size()) + " poses");
+        }
+
+        first = loadPGM(frames[0]);
+
+        if (!calibration_file.empty()) {
+            // the renderers scale it when it was calibrated at another resolution
+            camera = loadCalibration(calibration_file);
+
+            // raw frames, distort the overlay to match them unless --distortion says otherwise
+            if (!distortion_set && !camera.distortion().isZero()) {
+                distortion_mode = DistortionMode::DistortGeometry;
+            }
+        } else {
+            // intrinsics are in pixels of the frames
+            camera = CameraModel(first.width, first.height, intrinsics[0], intrinsics[1], intrinsics[2], intrinsics[3], intrinsics[4]);
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << "\n";
+        return -1;
+    }
+
+    const int width = first.width;
+    const int height = first.height;
+
+    const bool software = backend == "software";
+    std::unique_ptr<RenderContext> context;
+
+    try {
+        if (!software) {
+            context = createRenderContext(backend, width, height, "batch", false);
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << "\n";
+        return -1;
+    }
+
+    std::cout << "Rendering " << frames.size() << " frames of " << width << "x" << height << " with "
+        << (software ? "software" : context->name()) << "\n";
+
+    BlockingQueue<DecodedFrame> decoded(8);
+    BlockingQueue<RenderedFrame> rendered(8);
+
+    // per stage busy time in ms, written by the stage's own thread only
+    double decode_ms = 0;
+    double upload_ms = 0;
+    double render_ms = 0;
+    double readback_ms = 0;
+    double write_ms = 0;
+
+    std::atomic<bool> failed(false);
+
+    Clock::time_point start = Clock::now();
+
+    std::thread decoder([&]() {
+        try {
+            for (size_t i = 0; i < frames.size() && !failed; i++) {
+                Clock::time_point t = Clock::now();
+
+                DecodedFrame frame;
+                frame.index = i;
+                frame.image = loadPGM(frames[i]);
+
+                if (frame.image.width != width || frame.image.height != height) {
+                    throw std::runtime_error(frames[i] + " has a different size from the first frame");
+                }
+
+                decode_ms += elapsedMs(t);
+                decoded.push(std::move(frame));
+            }
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << "\n";
+            failed = true;
+        }
+
+        decoded.close();
+    });
+
+    std::thread writer([&]() {
+        RenderedFrame frame;
+
+        while (rendered.pop(frame)) {
+            Clock::time_point t = Clock::now();
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "/%06zu.ppm", frame.index);
+
+            try {
+                savePPM(output_dir + name, frame.image, frame.bottom_up);
+            } catch (const std::runtime_error &e) {
+                std::cerr << e.what() << "\n";
+                failed = true;
+                decoded.close();
+                rendered.close();
+                break;
+            }
+
+            write_ms += elapsedMs(t);
+        }
+    });
+
+    size_t num_rendered = 0;
+
+    try {
+        // CPU rendering has no upload or readback stage
+        if (software) {
+            SoftwareRasterizer rasterizer(width, height, cuboidMesh(board[0], board[1], board[2]));
+            rasterizer.setCamera(camera);
+            rasterizer.setDepthRange(depth_range[0], depth_range[1], depth_mode);
+
+            DecodedFrame frame;
+
+            while (decoded.pop(frame)) {
+                Clock::time_point t = Clock::now();
+
+                RenderedFrame out;
+                out.index = frame.index;
+                out.bottom_up = false;
+                rasterizer.draw(frame.image.data.data(), width, height, poses[frame.index], width, height, out.image);
+                render_ms += elapsedMs(t);
+
+                if (!rendered.push(std::move(out))) {
+                    break;
+                }
+
+                num_rendered++;
+            }
+        } else {
+            std::unique_ptr<FrameUploader> uploader = createFrameUploader(width, height, PixelFormat::Gray8, 1);
+
+            OverlayRenderer renderer(width, height, cuboidMesh(board[0], board[1], board[2]));
+            renderer.setCamera(camera);
+
+            renderer.setDistortionMode(distortion_mode);
+            renderer.setDepthRange(depth_range[0], depth_range[1], depth_mode);
+
+            bool writer_closed = false;
+
+            // copies out of the mapped PBO a few frames after it was rendered
+            FrameReadback readback(width, height, [&](uint64_t index, const unsigned char *rgba, int w, int h) {
+                RenderedFrame out;
+                out.index = index;
+                out.bottom_up = true;
+                out.image.width = w;
+                out.image.height = h;
+                out.image.channels = 4;
+                out.image.data.assign(rgba, rgba + static_cast<size_t>(w) * h * 4);
+
+                if (rendered.push(std::move(out))) {
+                    num_rendered++;
+                } else {
+                    writer_closed = true;
+                }
+            });
+
+            DecodedFrame frame;
+
+            while (!writer_closed && decoded.pop(frame)) {
+                Clock::time_point t = Clock::now();
+
+                // a single buffer so the texture holds this frame, not the previous one
+                uploader->upload(frame.image.data.data());
+                upload_ms += elapsedMs(t);
+
+                t = Clock::now();
+                context->beginFrame();
+                renderer.draw(uploader->textures(), poses[frame.index], width, height);
+                checkOpenGLFrame();
+                render_ms += elapsedMs(t);
+
+                t = Clock::now();
+                readback.readback(frame.index);
+                readback_ms += elapsedMs(t);
+
+                context->endFrame();
+            }
+
+            readback.flush();
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << "\n";
+        failed = true;
+        decoded.close();
+    }
+
+    rendered.close();
+    decoder.join();
+    writer.join();
+
+    double total_ms = elapsedMs(start);
+    size_t n = num_rendered > 0 ? num_rendered : 1;
+
+    std::cout << num_rendered << " frames in " << total_ms << " ms, " << num_rendered * 1000.0 / total_ms << " frames/sec\n";
+    std::cout << "per frame: decode " << decode_ms / n << " ms, upload " << upload_ms / n << " ms, render " << render_ms / n
+        << " ms, readback " << readback_ms / n << " ms, write " << write_ms / n << " ms\n";
+
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,110 @@
+#include <stdexcept>
+#include <string>
+
+#include "bayer_demosaic.hpp"
+#include "opengl_helper.hpp"
+#include "shader.hpp"
+
+BayerDemosaic::BayerDemosaic(int width, int height, DemosaicMethod method) :
+    width_(width),
+    height_(height),
+    method_(method)
+{
+    GL_CHECK(glGenTextures(1, &texture_));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture_));
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+    GLint previous = 0;
+    GL_CHECK(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous));
+
+    GL_CHECK(glGenFramebuffers(1, &framebuffer_));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_));
+    GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_, 0));
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, previous));
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        glDeleteFramebuffers(1, &framebuffer_);
+        glDeleteTextures(1, &texture_);
+        throw std::runtime_error("Demosaic framebuffer incomplete, status " + std::to_string(status));
+    }
+
+    // the full screen triangle has no attributes, but core profile still wants a VAO bound
+    GL_CHECK(glGenVertexArrays(1, &vertex_array_));
+}
+
+BayerDemosaic::~BayerDemosaic()
+{
+    glDeleteVertexArrays(1, &vertex_array_);
+    glDeleteFramebuffers(1, &framebuffer_);
+    glDeleteTextures(1, &texture_);
+}
+
+void BayerDemosaic::setLevels(float scale, float offset)
+{
+    level_scale_ = scale;
+    level_offset_ = offset;
+}
+
+BayerDemosaic::Pass &BayerDemosaic::pass(DemosaicMethod method)
+{
+    Pass &pass = passes_[method];
+
+    if (!pass.program) {
+        std::vector<std::string> defines;
+
+        if (method == DemosaicMethod::MalvarHeCutler) {
+            defines.push_back("MALVAR");
+        }
+
+        pass.program.reset(new ShaderProgram(FULLSCREEN_VERTEX_SHADER, shaderWithDefines(DEMOSAIC_FRAGMENT_SHADER, defines)));
+        pass.program->use();
+        pass.program->uniform<int>("rawTexture").set(0);
+        pass.red_offset = pass.program->uniform<glm::ivec2>("redOffset");
+        pass.level_scale = pass.program->uniform<float>("levelScale");
+        pass.level_offset = pass.program->uniform<float>("levelOffset");
+    }
+
+    return pass;
+}
+
+void BayerDemosaic::process(const FrameTextures &raw)
+{
+    if (!isBayer(raw.format())) {
+        throw std::runtime_error(std::string("Can't demosaic ") + pixelFormatName(raw.format()) + " frames");
+    }
+
+    if (raw.width() != width_ || raw.height() != height_) {
+        throw std::runtime_error("Bayer frame doesn't match the demosaic size");
+    }
+
+    int red_x, red_y;
+    bayerRedOffset(raw.format(), red_x, red_y);
+
+    GLint previous = 0;
+    GL_CHECK(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous));
+
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_));
+    GL_CHECK(glViewport(0, 0, width_, height_));
+
+    Pass &current = pass(method_);
+    current.program->use();
+    current.red_offset.set(glm::ivec2(red_x, red_y));
+    current.level_scale.set(level_scale_);
+    current.level_offset.set(level_offset_);
+
+    GL_CHECK(glActiveTexture(GL_TEXTURE0));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, raw.plane(0)));
+    GL_CHECK(glBindVertexArray(vertex_array_));
+    GL_CHECK(glDrawArrays(GL_TRIANGLES, 0, 3));
+    GL_CHECK(glBindVertexArray(0));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, previous));
+}
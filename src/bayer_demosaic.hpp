@@ -0,0 +1,65 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <map>
+#include <memory>
+
+#include "frame_textures.hpp"
+#include "shader_program.hpp"
+
+enum class DemosaicMethod
+{
+    Bilinear, // 3x3, cheapest, soft with color fringes on edges
+    MalvarHeCutler // 5x5 gradient corrected, close to what camera ISPs do
+};
+
+// Turns a Bayer frame into an RGBA8 texture with a full screen pass into a framebuffer object,
+// so the raw mosaic is uploaded as a single R8/R16 plane and never touched by the CPU.
+class BayerDemosaic
+{
+public:
+    BayerDemosaic(int width, int height, DemosaicMethod method = DemosaicMethod::MalvarHeCutler);
+    ~BayerDemosaic();
+
+    BayerDemosaic(const BayerDemosaic&) = delete;
+    BayerDemosaic& operator=(const BayerDemosaic&) = delete;
+
+    void setMethod(DemosaicMethod method) { method_ = method; }
+    DemosaicMethod method() const { return method_; }
+
+    // Linear mapping of the normalised samples, the output is scale * sample + offset
+    void setLevels(float scale, float offset);
+
+    // Demosaic raw into output(). Changes the viewport, the bound framebuffer is restored.
+    void process(const FrameTextures &raw);
+
+    GLuint output() const { return texture_; }
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+private:
+    struct Pass
+    {
+        std::unique_ptr<ShaderProgram> program;
+        Uniform<glm::ivec2> red_offset;
+        Uniform<float> level_scale;
+        Uniform<float> level_offset;
+    };
+
+    // compiled on first use
+    Pass &pass(DemosaicMethod method);
+
+    int width_;
+    int height_;
+    DemosaicMethod method_;
+    float level_scale_ = 1;
+    float level_offset_ = 0;
+
+    GLuint texture_ = 0;
+    GLuint framebuffer_ = 0;
+    GLuint vertex_array_ = 0;
+
+    std::map<DemosaicMethod, Pass> passes_;
+};
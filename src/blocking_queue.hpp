@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Bounded multi-producer multi-consumer queue. push() blocks while full, pop() blocks while
+// empty and returns false once the queue is closed and drained.
+template <typename T>
+class BlockingQueue
+{
+public:
+    explicit BlockingQueue(size_t capacity) : capacity_(capacity) {}
+
+    // Returns false and drops the item if the queue was closed
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this]() { return items_.size() < capacity_ || closed_; });
+
+        if (closed_) {
+            return false;
+        }
+
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this]() { return !items_.empty() || closed_; });
+
+        if (items_.empty()) {
+            return false;
+        }
+
+        item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+
+        return true;
+    }
+
+    // Wakes up everyone, items already queued can still be popped but no more can be pushed
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    bool closed_ = false;
+
+    std::deque<T> items_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
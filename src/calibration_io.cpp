@@ -0,0 +1,31 @@
+#include <stdexcept>
+
+#include "calibration_io.hpp"
+#include "opencv_storage.hpp"
+
+CameraModel loadCalibration(const std::string &filename)
+{
+    OpenCVStorage storage = OpenCVStorage::load(filename);
+
+    const StorageNode &k = storage.node("camera_matrix", StorageNode::Matrix);
+
+    if (k.rows != 3 || k.cols != 3) {
+        throw std::runtime_error(filename + ": camera_matrix should be 3x3");
+    }
+
+    int width = static_cast<int>(storage.node("image_width", StorageNode::Number).values[0]);
+    int height = static_cast<int>(storage.node("image_height", StorageNode::Number).values[0]);
+
+    DistortionCoeffs distortion;
+
+    if (const StorageNode *coeffs = storage.find("distortion_coefficients")) {
+        // a 1xN or Nx1 matrix, or a plain sequence from newer writers
+        if (coeffs->type != StorageNode::Matrix && coeffs->type != StorageNode::Sequence) {
+            throw std::runtime_error(filename + ": distortion_coefficients should be a matrix");
+        }
+
+        distortion = DistortionCoeffs::fromVector(std::vector<float>(coeffs->values.begin(), coeffs->values.end()));
+    }
+
+    return CameraModel::fromMatrix(width, height, k.values.data(), distortion);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+#include "camera_model.hpp"
+
+// Camera from the YAML or XML file written with cv::FileStorage by the OpenCV calibration
+// samples: camera_matrix (3x3), image_width, image_height and optionally distortion_coefficients
+// (4, 5 or 8 values). Throws if the file can't be parsed or an entry is missing or malformed.
+CameraModel loadCalibration(const std::string &filename);
@@ -0,0 +1,88 @@
+#include <stdexcept>
+#include <string>
+
+#include "camera_model.hpp"
+
+CameraModel::CameraModel()
+{
+}
+
+CameraModel::CameraModel(int width, int height, float fx, float fy, float cx, float cy, float skew,
+    const DistortionCoeffs &distortion) :
+    width_(width),
+    height_(height),
+    fx_(fx),
+    fy_(fy),
+    cx_(cx),
+    cy_(cy),
+    skew_(skew),
+    distortion_(distortion)
+{
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("Invalid camera image size " + std::to_string(width) + "x" + std::to_string(height));
+    }
+
+    if (fx == 0 || fy == 0) {
+        throw std::runtime_error("Camera focal length can't be 0");
+    }
+}
+
+CameraModel CameraModel::fromMatrix(int width, int height, const double k[9], const DistortionCoeffs &distortion)
+{
+    if (k[3] != 0 || k[6] != 0 || k[7] != 0 || k[8] != 1) {
+        throw std::runtime_error("Camera matrix is not of the form [fx skew cx; 0 fy cy; 0 0 1]");
+    }
+
+    return CameraModel(width, height, k[0], k[4], k[2], k[5], k[1], distortion);
+}
+
+glm::mat3 CameraModel::matrix() const
+{
+    // NOTE: glm is column first then row
+    glm::mat3 k(1.0);
+    k[0][0] = fx_;
+    k[1][0] = skew_;
+    k[2][0] = cx_;
+    k[1][1] = fy_;
+    k[2][1] = cy_;
+
+    return k;
+}
+
+CameraModel CameraModel::scaled(int width, int height) const
+{
+    float sx = static_cast<float>(width) / width_;
+    float sy = static_cast<float>(height) / height_;
+
+    return CameraModel(width, height, fx_*sx, fy_*sy, cx_*sx, cy_*sy, skew_*sx, distortion_);
+}
+
+glm::mat4 CameraModel::projection(int width, int height, float near_plane, float far_plane, DepthMode mode) const
+{
+    return perspectiveFromIntrinsics(fx_, fy_, cx_, cy_, skew_, width, height, near_plane, far_plane, mode);
+}
+
+glm::vec2 CameraModel::project(const glm::vec3 &p) const
+{
+    float x = p.x / p.z;
+    float y = p.y / p.z;
+
+    if (!distortion_.isZero()) {
+        distortPoint(distortion_, x, y, x, y);
+    }
+
+    return glm::vec2(fx_*x + skew_*y + cx_, fy_*y + cy_);
+}
+
+PointProjector CameraModel::projector(const glm::mat4 &model) const
+{
+    PointProjector projector(fx_, fy_, cx_, cy_, model);
+    projector.setCamera(fx_, fy_, cx_, cy_, skew_);
+
+    return projector;
+}
+
+std::vector<float> CameraModel::undistortMap() const
+{
+    return computeUndistortMap(distortion_, fx_, fy_, cx_, cy_, skew_, width_, height_);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <vector>
+
+#include "camera_projection.hpp"
+#include "distortion.hpp"
+#include "point_projector.hpp"
+
+// OpenCV calibration of a camera: the 3x3 camera matrix K, lens distortion and the image size
+// it was calibrated at,
+//       | fx  skew  cx |
+//   K = |  0   fy   cy |
+//       |  0    0    1 |
+// fx and fy differ for non-square pixels. Everything that projects through the camera, the
+// shader uniforms, PointProjector and the undistort remap, is derived from here.
+class CameraModel
+{
+public:
+    // Identity intrinsics of a 1x1 image, to assign a real camera to later
+    CameraModel();
+
+    CameraModel(int width, int height, float fx, float fy, float cx, float cy, float skew = 0,
+        const DistortionCoeffs &distortion = DistortionCoeffs());
+
+    // k is row-major as in OpenCV's camera_matrix. Throws if the bottom row isn't 0 0 1 or
+    // K[1][0] isn't 0.
+    static CameraModel fromMatrix(int width, int height, const double k[9], const DistortionCoeffs &distortion = DistortionCoeffs());
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+    float fx() const { return fx_; }
+    float fy() const { return fy_; }
+    float cx() const { return cx_; }
+    float cy() const { return cy_; }
+    float skew() const { return skew_; }
+
+    // NOTE: glm is column first then row, matrix()[2][0] is cx
+    glm::mat3 matrix() const;
+
+    const DistortionCoeffs &distortion() const { return distortion_; }
+    void setDistortion(const DistortionCoeffs &distortion) { distortion_ = distortion; }
+
+    // The same camera at another resolution of the same sensor area, eg. a binned or scaled
+    // stream. Distortion is in normalized coordinates and stays as it is.
+    CameraModel scaled(int width, int height) const;
+
+    // OpenGL projection for a viewport of width x height pixels of this camera, usually width()
+    // x height(), see perspectiveFromIntrinsics()
+    glm::mat4 projection(int width, int height, float near_plane, float far_plane, DepthMode mode = DepthMode::Standard) const;
+
+    // Pixel of a point in the camera frame, with distortion, like cv::projectPoints. Points on
+    // the camera plane come out as inf or nan.
+    glm::vec2 project(const glm::vec3 &p) const;
+
+    // Projector for batches of points without distortion, see PointProjector
+    PointProjector projector(const glm::mat4 &model = glm::mat4(1.0)) const;
+
+    // computeUndistortMap() for this camera
+    std::vector<float> undistortMap() const;
+
+private:
+    int width_ = 1;
+    int height_ = 1;
+
+    float fx_ = 1;
+    float fy_ = 1;
+    float cx_ = 0;
+    float cy_ = 0;
+    float skew_ = 0;
+
+    DistortionCoeffs distortion_;
+};
@@ -0,0 +1,58 @@
+#include <stdexcept>
+
+#include "camera_projection.hpp"
+
+glm::mat4 openCVToOpenGL()
+{
+    glm::mat4 m(1.0);
+    m[1][1] = -1;
+    m[2][2] = -1;
+
+    return m;
+}
+
+glm::mat4 perspectiveFromIntrinsics(float fx, float fy, float cx, float cy, float skew, int width, int height,
+    float near_plane, float far_plane, DepthMode mode)
+{
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("Invalid image size for the projection");
+    }
+
+    if (!(near_plane > 0 && far_plane > near_plane)) {
+        throw std::runtime_error("Projection needs 0 < near < far");
+    }
+
+    double w = width;
+    double h = height;
+    double n = near_plane;
+    double f = far_plane;
+
+    // Projection of OpenGL eye space, where a point at OpenCV (x, y, z) is at (x, -y, -z)
+    // NOTE: glm is column first then row
+    glm::mat4 m(0.0);
+
+    // x_ndc = 2*u/width - 1
+    m[0][0] = 2*fx / w;
+    m[1][0] = -2*skew / w;
+    m[2][0] = 1 - 2*cx / w;
+
+    // y_ndc = 1 - 2*v/height, NDC y points up like eye space y
+    m[1][1] = 2*fy / h;
+    m[2][1] = 2*cy / h - 1;
+
+    if (mode == DepthMode::ReversedZ) {
+        // z_ndc = n*(f - z) / ((f - n)*z), 1 at near and 0 at far
+        m[2][2] = n / (f - n);
+        m[3][2] = n*f / (f - n);
+    } else {
+        // z_ndc = ((f + n)*z - 2*f*n) / ((f - n)*z), -1 at near and 1 at far
+        m[2][2] = -(f + n) / (f - n);
+        m[3][2] = -2*f*n / (f - n);
+    }
+
+    // w = z, the distance in front of the camera, which looks down -z in eye space
+    m[2][3] = -1;
+
+    // flips only change signs, so this is exact
+    return m * openCVToOpenGL();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+
+// Which end of the depth range the near plane maps to, see perspectiveFromIntrinsics()
+enum class DepthMode
+{
+    Standard, // near at window depth 0, far at 1, GL_LESS and cleared to 1
+    ReversedZ // near at 1, far at 0, GL_GREATER and cleared to 0, needs glClipControl with GL_ZERO_TO_ONE
+};
+
+// The one place the two conventions meet. OpenCV's camera frame has x right, y down and z forward,
+// OpenGL eye space x right, y up and z backward. This flips y and z, it is its own inverse, so
+//   view = openCVToOpenGL() * pose
+// turns an OpenCV pose into a view matrix for code that works in eye space.
+glm::mat4 openCVToOpenGL();
+
+// OpenGL projection matrix for a pinhole camera with OpenCV intrinsics in pixels,
+//   u = (fx*x + skew*y + cx*z) / z
+//   v = (fy*y + cy*z) / z
+// It takes points in the OpenCV camera frame (x right, y down, z forward) to clip space with
+// w = z, so the GPU clips against the near and far planes and interpolates perspective-correct.
+// It is an eye space projection times openCVToOpenGL(), poses go in unchanged.
+// After the viewport transform pixel (u, v) of a width x height image lands on window x = u and
+// y = height - v, ie. the image is upright with rows from the top.
+//
+// Standard maps near to far to NDC z -1 to 1, the default clip range. ReversedZ maps them to 1 to 0
+// for a glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE) clip range. Window depth goes with 1/z so most
+// of its range is spent just beyond the near plane. Reversed, the far end sits at 0 where a float
+// depth buffer is densest, which about cancels out and leaves the same relative precision at
+// every distance, where standard depth gets coarser in proportion to z.
+glm::mat4 perspectiveFromIntrinsics(float fx, float fy, float cx, float cy, float skew, int width, int height,
+    float near_plane, float far_plane, DepthMode mode = DepthMode::Standard);
@@ -0,0 +1,167 @@
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+#include "capture_thread.hpp"
+
+CaptureThread::CaptureThread(std::unique_ptr<FrameSource> source, QueuePolicy policy, size_t capacity, bool fill_in_place) :
+    source_(std::move(source)),
+    policy_(policy),
+    width_(source_->width()),
+    height_(source_->height()),
+    format_(source_->format()),
+    fill_in_place_(fill_in_place && source_->canFill()),
+    filled_(capacity),
+    // room for everything in filled_ plus the frame the consumer is holding
+    returned_(capacity + 1),
+    lent_(capacity)
+{
+    thread_ = std::thread(fill_in_place_ ? &CaptureThread::runFill : &CaptureThread::run, this);
+}
+
+CaptureThread::~CaptureThread()
+{
+    stop();
+
+    // filled frames went into lent buffers, there is nothing to give back to the source
+    if (fill_in_place_) {
+        return;
+    }
+
+    // release whatever is left, oldest first
+    Frame frame;
+
+    while (returned_.tryPop(frame)) {
+        source_->release(frame);
+    }
+
+    while (filled_.tryPop(frame)) {
+        source_->release(frame);
+    }
+}
+
+void CaptureThread::stop()
+{
+    stop_ = true;
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool CaptureThread::provide(unsigned char *dst)
+{
+    return lent_.tryPush(dst);
+}
+
+void CaptureThread::runFill()
+{
+    unsigned char *dst = nullptr;
+    Frame frame;
+
+    try {
+        while (!stop_) {
+            if (ended_ || (!dst && !lent_.tryPop(dst))) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+
+            AcquireResult result = source_->fill(dst, frame);
+
+            if (result == AcquireResult::Ended) {
+                ended_ = true;
+                continue;
+            }
+
+            if (result == AcquireResult::Timeout) {
+                continue;
+            }
+
+            // can't fail, there are never more lent buffers than filled_ holds
+            filled_.tryPush(frame);
+            dst = nullptr;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Capture stopped: " << e.what() << "\n";
+        ended_ = true;
+    }
+}
+
+void CaptureThread::run()
+{
+    size_t borrowed = 0;
+    Frame frame;
+
+    try {
+        while (!stop_) {
+            while (returned_.tryPop(frame)) {
+                source_->release(frame);
+                borrowed--;
+            }
+
+            // The source has nothing left to lend, or the queue is full and every frame counts.
+            // Nothing to block on without a lock, so back off briefly.
+            if (ended_ || borrowed >= source_->maxBorrowed() || (policy_ == QueuePolicy::Fifo && filled_.size() >= filled_.capacity())) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+
+            AcquireResult result = source_->acquire(frame);
+
+            if (result == AcquireResult::Ended) {
+                ended_ = true;
+                continue;
+            }
+
+            // a live source that had nothing for a while, it may still send more
+            if (result == AcquireResult::Timeout) {
+                continue;
+            }
+
+            if (filled_.tryPush(frame)) {
+                borrowed++;
+            } else {
+                source_->release(frame);
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Capture stopped: " << e.what() << "\n";
+        ended_ = true;
+    }
+}
+
+bool CaptureThread::next(Frame &frame)
+{
+    if (!filled_.tryPop(frame)) {
+        return false;
+    }
+
+    // every lent buffer has to come back
+    if (policy_ == QueuePolicy::Latest && !fill_in_place_) {
+        Frame newer;
+
+        // returned in the order they were captured, the source relies on that
+        while (filled_.tryPop(newer)) {
+            returned_.tryPush(frame);
+            frame = newer;
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    return true;
+}
+
+void CaptureThread::release(const Frame &frame)
+{
+    // can't fail, returned_ has room for every outstanding frame. Filled frames are the
+    // consumer's own buffers.
+    if (!fill_in_place_) {
+        returned_.tryPush(frame);
+    }
+}
+
+bool CaptureThread::finished() const
+{
+    return ended_ && filled_.size() == 0;
+}
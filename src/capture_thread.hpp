@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "frame_source.hpp"
+#include "spsc_queue.hpp"
+
+// What the consumer gets when it falls behind the capture
+enum class QueuePolicy
+{
+    Latest, // next() skips to the newest frame and hands the stale ones straight back (live camera)
+    Fifo // every frame, in order, the capture waits while the queue is full (recording, files)
+};
+
+// Runs a FrameSource on its own thread so a blocking swap on the render thread never holds up
+// capture. Frames are passed by pointer through a lock-free SPSC queue, and handed back through a
+// second one so the capture thread can release them to the source in order. Nothing is copied.
+//
+// With QueuePolicy::Latest a frame captured while the queue is full is dropped straight away.
+// With either policy the capture waits while the source itself has no more frames to lend out,
+// see FrameSource::maxBorrowed().
+//
+// With fill_in_place and a source that can, the consumer lends the buffers to capture into
+// instead, eg. mapped FrameUploader::acquire() memory, and the source writes each frame straight
+// into one of them, see FrameSource::fill(). The capture waits for a buffer and nothing is
+// dropped or skipped, every lent buffer comes back from next() in the order it was lent.
+class CaptureThread
+{
+public:
+    CaptureThread(std::unique_ptr<FrameSource> source, QueuePolicy policy, size_t capacity = 4, bool fill_in_place = false);
+
+    // Every frame from next() must be released before this
+    ~CaptureThread();
+
+    CaptureThread(const CaptureThread&) = delete;
+    CaptureThread& operator=(const CaptureThread&) = delete;
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    PixelFormat format() const { return format_; }
+
+    // Consumer thread, the render thread or an UploadWorker, one of them only. Returns false if
+    // no new frame is ready, never blocks.
+    bool next(Frame &frame);
+
+    // Consumer thread. Hand back a frame from next() once it's uploaded.
+    void release(const Frame &frame);
+
+    // The source ran out and every frame has been handed out
+    bool finished() const;
+
+    // Frames go into buffers from provide() rather than the source's own
+    bool fillsInPlace() const { return fill_in_place_; }
+
+    // Consumer thread. Lend a tightly packed frame sized buffer for the next frame, it comes back
+    // as next()'s frame.data. False if capacity buffers are lent already.
+    bool provide(unsigned char *dst);
+
+    // Consumer thread. Stops the capture, after which no lent buffer is written anymore, eg.
+    // before unmapping them. The destructor stops it too.
+    void stop();
+
+    // Frames thrown away by the capture (queue full) and by next() (stale), from any thread
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t skipped() const { return skipped_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void runFill();
+
+    std::unique_ptr<FrameSource> source_;
+    QueuePolicy policy_;
+    int width_;
+    int height_;
+    PixelFormat format_;
+
+    bool fill_in_place_;
+
+    SpscQueue<Frame> filled_; // capture -> render
+    SpscQueue<Frame> returned_; // render -> capture
+    SpscQueue<unsigned char*> lent_; // render -> capture, with fill_in_place_
+
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> ended_{false};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> skipped_{0};
+
+    std::thread thread_;
+};
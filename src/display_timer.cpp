@@ -0,0 +1,97 @@
+#include <stdexcept>
+
+#include "display_timer.hpp"
+#include "frame_source.hpp"
+#include "opengl_helper.hpp"
+
+// frames in flight before the oldest is given up on, a GPU that far behind measures nothing useful
+static const size_t MAX_PENDING = 8;
+
+// weight of a new measurement in the running average
+static const double AVERAGE_WEIGHT = 0.1;
+
+DisplayTimer::~DisplayTimer()
+{
+    for (Pending &pending : pending_) {
+        glDeleteSync(pending.fence);
+    }
+}
+
+int64_t DisplayTimer::beginFrame()
+{
+    poll();
+
+    start_ns_ = steadyNanoseconds();
+
+    return start_ns_ + static_cast<int64_t>(average_latency_ns_ > 0 ? average_latency_ns_ : 0);
+}
+
+void DisplayTimer::endFrame(int64_t motion_ns, int64_t pose_ns)
+{
+    if (pending_.size() == MAX_PENDING) {
+        GL_CHECK(glDeleteSync(pending_.front().fence));
+        pending_.pop_front();
+    }
+
+    Pending pending;
+    GL_CHECK(pending.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    pending.start_ns = start_ns_;
+    pending.motion_ns = motion_ns;
+    pending.pose_ns = pose_ns;
+
+    pending_.push_back(pending);
+}
+
+void DisplayTimer::poll()
+{
+    // frames finish in order
+    while (!pending_.empty()) {
+        Pending &pending = pending_.front();
+        GLenum status = glClientWaitSync(pending.fence, 0, 0);
+
+        if (status == GL_WAIT_FAILED) {
+            throw std::runtime_error("glClientWaitSync failed on a frame fence");
+        }
+
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return;
+        }
+
+        int64_t displayed_ns = steadyNanoseconds();
+        double latency_ns = static_cast<double>(displayed_ns - pending.start_ns);
+
+        average_latency_ns_ = average_latency_ns_ < 0 ? latency_ns :
+            average_latency_ns_ + AVERAGE_WEIGHT * (latency_ns - average_latency_ns_);
+
+        measured_++;
+        latency_total_ns_ += latency_ns;
+
+        if (pending.motion_ns != 0) {
+            measured_motion_++;
+            motion_total_ns_ += static_cast<double>(displayed_ns - pending.motion_ns);
+            residual_total_ns_ += static_cast<double>(displayed_ns - pending.pose_ns);
+        }
+
+        GL_CHECK(glDeleteSync(pending.fence));
+        pending_.pop_front();
+    }
+}
+
+bool DisplayTimer::report(double &latency_ms, double &motion_to_photon_ms, double &residual_ms)
+{
+    if (measured_ == 0) {
+        return false;
+    }
+
+    latency_ms = latency_total_ns_ / measured_ * 1e-6;
+    motion_to_photon_ms = measured_motion_ > 0 ? motion_total_ns_ / measured_motion_ * 1e-6 : 0.0;
+    residual_ms = measured_motion_ > 0 ? residual_total_ns_ / measured_motion_ * 1e-6 : 0.0;
+
+    measured_ = 0;
+    measured_motion_ = 0;
+    latency_total_ns_ = 0;
+    motion_total_ns_ = 0;
+    residual_total_ns_ = 0;
+
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <deque>
+
+// Predicts when the frame being rendered is going to be displayed and measures when it was, to
+// sample tracking data at the display time (see PoseBuffer) and report motion-to-photon latency.
+// Render thread only, with its context current. Times are steady clock nanoseconds.
+//
+// A fence follows each frame's commands and is polled without blocking, the time it is seen
+// signalled counts as displayed. That is when the GPU finished the frame, as close as GL gets
+// without presentation timing extensions, with vsync the flip follows within a refresh. The
+// prediction is the frame start plus the running average of the measured latency.
+class DisplayTimer
+{
+public:
+    DisplayTimer() = default;
+    ~DisplayTimer();
+
+    DisplayTimer(const DisplayTimer&) = delete;
+    DisplayTimer& operator=(const DisplayTimer&) = delete;
+
+    // Start of a frame, before sampling the tracking data. Returns the predicted display time.
+    int64_t beginFrame();
+
+    // After the frame's draw calls, before the swap. motion_ns is the timestamp of the newest
+    // tracking data the frame used and pose_ns the time its pose was sampled at, eg. the predicted
+    // display time, both 0 if there is no tracking data.
+    void endFrame(int64_t motion_ns, int64_t pose_ns);
+
+    // Measures finished frames without blocking. beginFrame() does this too, calling it right
+    // after the swap as well makes the measurement tighter.
+    void poll();
+
+    // Averages over the frames measured since the last call, false if there were none.
+    // latency is frame start to display, motion_to_photon the tracking data timestamp to display
+    // and residual the pose time to display, what is left of the latency after prediction. The
+    // last two are 0 without tracking data.
+    bool report(double &latency_ms, double &motion_to_photon_ms, double &residual_ms);
+
+private:
+    struct Pending
+    {
+        GLsync fence;
+        int64_t start_ns;
+        int64_t motion_ns;
+        int64_t pose_ns;
+    };
+
+    std::deque<Pending> pending_;
+
+    int64_t start_ns_ = 0;
+    double average_latency_ns_ = -1; // -1 until the first frame is measured
+
+    int measured_ = 0;
+    int measured_motion_ = 0;
+    double latency_total_ns_ = 0;
+    double motion_total_ns_ = 0;
+    double residual_total_ns_ = 0;
+};
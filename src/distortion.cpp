@@ -0,0 +1,62 @@
+#include <stdexcept>
+
+#include "distortion.hpp"
+
+DistortionCoeffs DistortionCoeffs::fromVector(const std::vector<float> &coeffs)
+{
+    if (coeffs.size() != 4 && coeffs.size() != 5 && coeffs.size() != 8) {
+        throw std::runtime_error("Expected 4, 5 or 8 distortion coefficients");
+    }
+
+    DistortionCoeffs dist;
+    float *dst[] = {&dist.k1, &dist.k2, &dist.p1, &dist.p2, &dist.k3, &dist.k4, &dist.k5, &dist.k6};
+
+    for (size_t i = 0; i < coeffs.size(); i++) {
+        *dst[i] = coeffs[i];
+    }
+
+    return dist;
+}
+
+bool DistortionCoeffs::isZero() const
+{
+    return k1 == 0 && k2 == 0 && p1 == 0 && p2 == 0 && k3 == 0 && k4 == 0 && k5 == 0 && k6 == 0;
+}
+
+void distortPoint(const DistortionCoeffs &dist, float x, float y, float &xd, float &yd)
+{
+    float r2 = x*x + y*y;
+    float r4 = r2*r2;
+    float r6 = r4*r2;
+
+    float radial = (1 + dist.k1*r2 + dist.k2*r4 + dist.k3*r6) / (1 + dist.k4*r2 + dist.k5*r4 + dist.k6*r6);
+
+    xd = x*radial + 2*dist.p1*x*y + dist.p2*(r2 + 2*x*x);
+    yd = y*radial + dist.p1*(r2 + 2*y*y) + 2*dist.p2*x*y;
+}
+
+std::vector<float> computeUndistortMap(
+    const DistortionCoeffs &dist,
+    float fx, float fy, float cx, float cy, float skew,
+    int width, int height)
+{
+    std::vector<float> map(static_cast<size_t>(width) * height * 2);
+    float *dst = map.data();
+
+    for (int v = 0; v < height; v++) {
+        for (int u = 0; u < width; u++) {
+            float y = (v - cy) / fy;
+            float x = (u - cx - skew*y) / fx;
+            float xd, yd;
+
+            distortPoint(dist, x, y, xd, yd);
+
+            // pixel in the distorted image, then to texture coordinate at the pixel center
+            dst[0] = (fx*xd + skew*yd + cx + 0.5f) / width;
+            dst[1] = (fy*yd + cy + 0.5f) / height;
+            dst += 2;
+        }
+    }
+
+    return map;
+}
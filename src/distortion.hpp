@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+// OpenCV lens distortion coefficients. The order matches OpenCV's distCoeffs vector,
+// k4-k6 are only used by the rational model (CALIB_RATIONAL_MODEL) and can be left at zero.
+struct DistortionCoeffs
+{
+    float k1 = 0;
+    float k2 = 0;
+    float p1 = 0;
+    float p2 = 0;
+    float k3 = 0;
+    float k4 = 0;
+    float k5 = 0;
+    float k6 = 0;
+
+    // Accepts 4, 5 or 8 values as output by cv::calibrateCamera
+    static DistortionCoeffs fromVector(const std::vector<float> &coeffs);
+
+    bool isZero() const;
+};
+
+// Apply the forward OpenCV distortion model to a normalized image point (x/z, y/z)
+void distortPoint(const DistortionCoeffs &dist, float x, float y, float &xd, float &yd);
+
+// Equivalent of cv::initUndistortRectifyMap with R = identity and newCameraMatrix = K.
+// For every pixel of the undistorted width x height output it stores the texture coordinate
+// (s, t) to sample in the distorted input. Returns width * height interleaved (s, t) pairs,
+// row 0 being the top of the image.
+std::vector<float> computeUndistortMap(
+    const DistortionCoeffs &dist,
+    float fx, float fy, float cx, float cy, float skew,
+    int width, int height);
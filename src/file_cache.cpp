@@ -0,0 +1,55 @@
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+#include "file_cache.hpp"
+
+bool makeDirectories(const std::string &path)
+{
+    for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+        std::string dir = path.substr(0, pos);
+
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+
+        if (pos == std::string::npos) {
+            return true;
+        }
+    }
+}
+
+void CacheKey::add(const char *str)
+{
+    for (const char *c = str; c && *c; c++) {
+        hash_ = (hash_ ^ static_cast<unsigned char>(*c)) * 1099511628211ull;
+    }
+
+    hash_ = hash_ * 1099511628211ull;
+}
+
+std::string CacheKey::hex() const
+{
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << hash_;
+
+    return ss.str();
+}
+
+bool replaceFile(const std::string &filename, const std::function<void(std::ofstream&)> &write)
+{
+    std::string tmp = filename + ".tmp";
+    std::ofstream file(tmp, std::ios::binary);
+
+    write(file);
+    file.close();
+
+    if (!file || std::rename(tmp.c_str(), filename.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
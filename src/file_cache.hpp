@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+
+// What the on-disk caches share, the program binaries in opengl_helper.cpp and the parsed poses
+// in pose_io.cpp
+
+// Creates path and its missing parents, false if one can't be created
+bool makeDirectories(const std::string &path);
+
+// 64 bit FNV-1a over a list of strings, for cache file names
+class CacheKey
+{
+public:
+    // A null str adds nothing but the separator, which keeps "ab" + "c" apart from "a" + "bc"
+    void add(const char *str);
+    void add(const std::string &str) { add(str.c_str()); }
+
+    // 16 hex digits
+    std::string hex() const;
+
+private:
+    uint64_t hash_ = 14695981039346656037ull;
+};
+
+// Writes filename.tmp with write and renames it to filename, so a concurrent start never sees a
+// partial file. False if either fails, the temporary is removed then.
+bool replaceFile(const std::string &filename, const std::function<void(std::ofstream&)> &write);
@@ -0,0 +1,88 @@
+#include <stdexcept>
+#include <string>
+
+#include "frame_readback.hpp"
+#include "opengl_helper.hpp"
+
+FrameReadback::FrameReadback(int width, int height, const Callback &callback, int num_buffers) :
+    width_(width),
+    height_(height),
+    frame_size_(static_cast<size_t>(width) * height * 4),
+    callback_(callback),
+    ids_(num_buffers, 0),
+    pending_(num_buffers, false)
+{
+    if (num_buffers < 1) {
+        throw std::runtime_error("FrameReadback needs at least one buffer");
+    }
+
+    pbo_.resize(num_buffers);
+    GL_CHECK(glGenBuffers(num_buffers, pbo_.data()));
+
+    for (GLuint pbo : pbo_) {
+        GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo));
+        GL_CHECK(glBufferData(GL_PIXEL_PACK_BUFFER, frame_size_, nullptr, GL_STREAM_READ));
+    }
+
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+}
+
+FrameReadback::~FrameReadback()
+{
+    glDeleteBuffers(pbo_.size(), pbo_.data());
+}
+
+void FrameReadback::readback(uint64_t id)
+{
+    // the slot we are about to reuse holds the oldest frame
+    if (pending_[index_]) {
+        complete(index_);
+    }
+
+    GL_CHECK(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[index_]));
+    GL_CHECK(glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+    ids_[index_] = id;
+    pending_[index_] = true;
+    index_ = (index_ + 1) % pbo_.size();
+}
+
+void FrameReadback::flush()
+{
+    // oldest first
+    for (size_t i = 0; i < pbo_.size(); i++) {
+        size_t index = (index_ + i) % pbo_.size();
+
+        if (pending_[index]) {
+            complete(index);
+        }
+    }
+}
+
+void FrameReadback::complete(size_t index)
+{
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[index]));
+
+    void *ptr = nullptr;
+    GL_CHECK(ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame_size_, GL_MAP_READ_BIT));
+
+    pending_[index] = false;
+
+    if (!ptr) {
+        GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        throw std::runtime_error("FrameReadback: glMapBufferRange failed");
+    }
+
+    try {
+        callback_(ids_[index], static_cast<const unsigned char*>(ptr), width_, height_);
+    } catch (...) {
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        throw;
+    }
+
+    GL_CHECK(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Reads rendered frames back to the CPU through a ring of pixel pack buffers (PBO).
+// readback() queues glReadPixels into the next PBO and returns straight away. The PBO is
+// mapped num_buffers calls later, when readback() comes round to it again, by which time the
+// transfer has long finished, so the render loop never waits on the GPU. flush() maps the
+// frames still pending.
+class FrameReadback
+{
+public:
+    // rgba is width x height, rows bottom to top as with glReadPixels, and only valid during the call
+    typedef std::function<void(uint64_t id, const unsigned char *rgba, int width, int height)> Callback;
+
+    FrameReadback(int width, int height, const Callback &callback, int num_buffers = 3);
+    ~FrameReadback();
+
+    FrameReadback(const FrameReadback&) = delete;
+    FrameReadback& operator=(const FrameReadback&) = delete;
+
+    // Queue a copy of the bound read framebuffer, id is handed back to the callback
+    void readback(uint64_t id);
+
+    // Hand over every pending frame, eg. at the end of a recording
+    void flush();
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+private:
+    void complete(size_t index);
+
+    int width_;
+    int height_;
+    size_t frame_size_;
+    Callback callback_;
+
+    std::vector<GLuint> pbo_;
+    std::vector<uint64_t> ids_;
+    std::vector<bool> pending_;
+    size_t index_ = 0;
+};
@@ -0,0 +1,517 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+
+#include "frame_source.hpp"
+#include "image_io.hpp"
+#include "left09.hpp"
+#include "shm_frame_ring.hpp"
+
+int64_t steadyNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Sleep until the next frame is due at fps frames a second. A source that falls behind
+// doesn't try to catch up.
+static void pace(std::chrono::steady_clock::time_point &next_frame, double fps)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if (next_frame > now) {
+        std::this_thread::sleep_until(next_frame);
+    } else {
+        next_frame = now;
+    }
+
+    next_frame += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / fps));
+}
+
+AcquireResult FrameSource::fill(unsigned char *dst, Frame &frame)
+{
+    throw std::runtime_error("This frame source can't fill buffers, it lends its own");
+}
+
+AssetFrameSource::AssetFrameSource(double fps) :
+    fps_(fps)
+{
+    // map the pack now rather than on the first frame
+    left09_data();
+}
+
+int AssetFrameSource::width() const
+{
+    return left09_width();
+}
+
+int AssetFrameSource::height() const
+{
+    return left09_height();
+}
+
+AcquireResult AssetFrameSource::acquire(Frame &frame)
+{
+    pace(next_frame_, fps_);
+
+    frame.data = left09_data();
+    frame.width = left09_width();
+    frame.height = left09_height();
+    frame.format = PixelFormat::Gray8;
+    frame.stride = left09_width();
+    frame.timestamp_ns = steadyNanoseconds();
+    frame.sequence = sequence_++;
+    frame.handle = 0;
+
+    return AcquireResult::Acquired;
+}
+
+SyntheticFrameSource::SyntheticFrameSource(int width, int height, PixelFormat format, size_t num_buffers) :
+    width_(width),
+    height_(height),
+    format_(format),
+    buffers_(num_buffers, blackFrame(format, width, height))
+{
+    if (num_buffers == 0) {
+        throw std::runtime_error("SyntheticFrameSource needs at least one buffer");
+    }
+}
+
+void SyntheticFrameSource::generate(unsigned char *data, uint64_t sequence) const
+{
+    generateLuma(data, sequence);
+
+    if (isYuv(format_)) {
+        generateChroma(data);
+    }
+}
+
+void SyntheticFrameSource::generateLuma(unsigned char *data, uint64_t sequence) const
+{
+    std::vector<PlaneLayout> planes = planeLayout(format_, width_, height_);
+
+    if (isBayer(format_)) {
+        // red scrolls across, green is a vertical ramp and blue the same diagonal as the other formats
+        int red_x, red_y;
+        bayerRedOffset(format_, red_x, red_y);
+
+        for (int y = 0; y < height_; y++) {
+            unsigned char *row = data + y*planes[0].stride;
+
+            for (int x = 0; x < width_; x++) {
+                int phase_x = (x + red_x) & 1;
+                int phase_y = (y + red_y) & 1;
+
+                unsigned char value = phase_x != phase_y ? y :
+                    static_cast<unsigned char>(phase_x == 0 ? x + sequence : x + y + sequence);
+
+                if (planes[0].bytes_per_channel == 2) {
+                    reinterpret_cast<uint16_t*>(row)[x] = value * 257;
+                } else {
+                    row[x] = value;
+                }
+            }
+        }
+    } else {
+        // diagonal gradient scrolling one pixel per frame, in YUYV every other byte
+        int step = format_ == PixelFormat::YUYV ? 2 : 1;
+
+        for (int y = 0; y < height_; y++) {
+            unsigned char *row = data + y*planes[0].stride;
+
+            for (int x = 0; x < width_; x++) {
+                unsigned char value = static_cast<unsigned char>(x + y + sequence);
+
+                if (format_ == PixelFormat::Gray16 || format_ == PixelFormat::Gray16UI) {
+                    reinterpret_cast<uint16_t*>(row)[x] = value * 257;
+                } else if (format_ == PixelFormat::Gray32F) {
+                    reinterpret_cast<float*>(row)[x] = value / 255.0f;
+                } else {
+                    row[x*step] = value;
+                }
+            }
+        }
+    }
+}
+
+// U across, V down
+void SyntheticFrameSource::generateChroma(unsigned char *data) const
+{
+    std::vector<PlaneLayout> planes = planeLayout(format_, width_, height_);
+
+    std::vector<unsigned char> u(width_ / 2);
+
+    for (int x = 0; x < width_ / 2; x++) {
+        u[x] = x * 255 / (width_ / 2);
+    }
+
+    for (int y = 0; y < height_ / 2; y++) {
+        unsigned char v = y * 255 / (height_ / 2);
+
+        for (int x = 0; x < width_ / 2; x++) {
+            switch (format_) {
+                case PixelFormat::NV12:
+                    data[planes[1].offset + y*planes[1].stride + x*2] = u[x];
+                    data[planes[1].offset + y*planes[1].stride + x*2 + 1] = v;
+                    break;
+                case PixelFormat::I420:
+                    data[planes[1].offset + y*planes[1].stride + x] = u[x];
+                    data[planes[2].offset + y*planes[2].stride + x] = v;
+                    break;
+                case PixelFormat::YUYV:
+                    for (int row = y*2; row < y*2 + 2; row++) {
+                        data[row*planes[0].stride + x*4 + 1] = u[x];
+                        data[row*planes[0].stride + x*4 + 3] = v;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+AcquireResult SyntheticFrameSource::acquire(Frame &frame)
+{
+    if (sequence_ - released_ >= buffers_.size()) {
+        throw std::runtime_error("SyntheticFrameSource: too many frames borrowed");
+    }
+
+    return fill(buffers_[sequence_ % buffers_.size()].data(), frame);
+}
+
+AcquireResult SyntheticFrameSource::fill(unsigned char *dst, Frame &frame)
+{
+    generate(dst, sequence_);
+
+    frame.data = dst;
+    frame.width = width_;
+    frame.height = height_;
+    frame.format = format_;
+    frame.stride = planeLayout(format_, width_, height_)[0].stride;
+    frame.timestamp_ns = steadyNanoseconds();
+    frame.sequence = sequence_;
+    frame.handle = sequence_;
+
+    sequence_++;
+
+    return AcquireResult::Acquired;
+}
+
+void SyntheticFrameSource::release(const Frame &frame)
+{
+    released_ = frame.handle + 1;
+}
+
+FileSequenceFrameSource::FileSequenceFrameSource(const std::string &dir, bool loop, double fps, int raw_width, int raw_height,
+        PixelFormat raw_format) :
+    loop_(loop),
+    fps_(fps),
+    raw_width_(raw_width),
+    raw_height_(raw_height),
+    raw_format_(raw_format)
+{
+    files_ = listFiles(dir, ".pgm");
+
+    std::vector<std::string> raw = listFiles(dir, ".raw");
+
+    if (!raw.empty() && (raw_width <= 0 || raw_height <= 0)) {
+        throw std::runtime_error(dir + " has raw frames, their size must be given");
+    }
+
+    if (!raw.empty() && !files_.empty() && raw_format != PixelFormat::Gray8) {
+        throw std::runtime_error(dir + " mixes PGM and " + pixelFormatName(raw_format) + " frames");
+    }
+
+    if (!raw.empty()) {
+        format_ = raw_format;
+    }
+
+    files_.insert(files_.end(), raw.begin(), raw.end());
+    std::sort(files_.begin(), files_.end());
+
+    if (files_.empty()) {
+        throw std::runtime_error("No .pgm or .raw frames in " + dir);
+    }
+
+    // size of the stream from the first frame
+    Mapping first = map(files_[0]);
+    width_ = first.width;
+    height_ = first.height;
+    unmap(first);
+}
+
+FileSequenceFrameSource::~FileSequenceFrameSource()
+{
+    unmap(current_);
+}
+
+size_t FileSequenceFrameSource::pixelOffset(const std::string &filename, const unsigned char *header, size_t header_size,
+    size_t size, int &width, int &height) const
+{
+    size_t offset = 0;
+
+    if (filename.compare(filename.size() - 4, 4, ".pgm") == 0) {
+        // P5 header, assumes no comments, which is what every writer we care about produces
+        int maxval = 0;
+        int consumed = 0;
+        std::string text(reinterpret_cast<const char*>(header), std::min<size_t>(header_size, 64));
+
+        if (std::sscanf(text.c_str(), "P5 %d %d %d%n", &width, &height, &maxval, &consumed) != 3 || maxval != 255) {
+            throw std::runtime_error(filename + " is not an 8-bit binary PGM");
+        }
+
+        // single whitespace before the pixels
+        offset = consumed + 1;
+    } else {
+        width = raw_width_;
+        height = raw_height_;
+    }
+
+    if (offset + frameSize(format_, width, height) > size) {
+        throw std::runtime_error(filename + " is truncated");
+    }
+
+    return offset;
+}
+
+FileSequenceFrameSource::Mapping FileSequenceFrameSource::map(const std::string &filename) const
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        throw std::runtime_error("Can't open " + filename);
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Can't stat " + filename);
+    }
+
+    Mapping mapping;
+    mapping.size = st.st_size;
+    mapping.addr = mmap(nullptr, mapping.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping.addr == MAP_FAILED) {
+        throw std::runtime_error("Can't mmap " + filename);
+    }
+
+    const unsigned char *bytes = static_cast<const unsigned char*>(mapping.addr);
+
+    try {
+        mapping.pixels = bytes + pixelOffset(filename, bytes, mapping.size, mapping.size, mapping.width, mapping.height);
+    } catch (const std::runtime_error &) {
+        unmap(mapping);
+        throw;
+    }
+
+    return mapping;
+}
+
+void FileSequenceFrameSource::unmap(Mapping &mapping)
+{
+    if (mapping.addr) {
+        munmap(mapping.addr, mapping.size);
+    }
+
+    mapping = Mapping();
+}
+
+bool FileSequenceFrameSource::nextFile(std::string &filename)
+{
+    if (sequence_ >= files_.size() && !loop_) {
+        return false;
+    }
+
+    pace(next_frame_, fps_);
+    filename = files_[sequence_ % files_.size()];
+
+    return true;
+}
+
+void FileSequenceFrameSource::fillFrame(Frame &frame, const unsigned char *data)
+{
+    frame.data = data;
+    frame.width = width_;
+    frame.height = height_;
+    frame.format = format_;
+    frame.stride = planeLayout(format_, width_, height_)[0].stride;
+    frame.timestamp_ns = steadyNanoseconds();
+    frame.sequence = sequence_;
+    frame.handle = sequence_;
+
+    sequence_++;
+}
+
+AcquireResult FileSequenceFrameSource::acquire(Frame &frame)
+{
+    if (current_.addr) {
+        throw std::runtime_error("FileSequenceFrameSource: previous frame not released");
+    }
+
+    std::string filename;
+
+    if (!nextFile(filename)) {
+        return AcquireResult::Ended;
+    }
+
+    current_ = map(filename);
+
+    if (current_.width != width_ || current_.height != height_) {
+        unmap(current_);
+        throw std::runtime_error(filename + " doesn't match the size of the first frame");
+    }
+
+    // read ahead, the upload is going to touch every page anyway
+    madvise(current_.addr, current_.size, MADV_WILLNEED);
+
+    fillFrame(frame, current_.pixels);
+
+    return AcquireResult::Acquired;
+}
+
+void FileSequenceFrameSource::release(const Frame &frame)
+{
+    unmap(current_);
+}
+
+// Every byte of size at offset, pread() may return less than asked for
+static bool readFully(int fd, unsigned char *dst, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t n = pread(fd, dst, size, offset);
+
+        if (n <= 0) {
+            return false;
+        }
+
+        dst += n;
+        size -= n;
+        offset += n;
+    }
+
+    return true;
+}
+
+AcquireResult FileSequenceFrameSource::fill(unsigned char *dst, Frame &frame)
+{
+    std::string filename;
+
+    if (!nextFile(filename)) {
+        return AcquireResult::Ended;
+    }
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        throw std::runtime_error("Can't open " + filename);
+    }
+
+    unsigned char header[64];
+    ssize_t header_size = pread(fd, header, sizeof(header), 0);
+    int width = 0;
+    int height = 0;
+    size_t offset;
+
+    try {
+        offset = pixelOffset(filename, header, std::max<ssize_t>(header_size, 0), st.st_size, width, height);
+
+        if (width != width_ || height != height_) {
+            throw std::runtime_error(filename + " doesn't match the size of the first frame");
+        }
+
+        if (!readFully(fd, dst, frameSize(format_, width_, height_), offset)) {
+            throw std::runtime_error("Can't read " + filename);
+        }
+    } catch (const std::runtime_error &) {
+        close(fd);
+        throw;
+    }
+
+    close(fd);
+    fillFrame(frame, dst);
+
+    return AcquireResult::Acquired;
+}
+
+// "640x480" to width and height
+static void parseSize(const std::string &text, int &width, int &height)
+{
+    if (std::sscanf(text.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+        throw std::runtime_error("Invalid frame size " + text + ", expected WIDTHxHEIGHT");
+    }
+}
+
+// Strip a trailing ":FORMAT" from arg if there is one
+static PixelFormat popFormat(std::string &arg)
+{
+    size_t colon = arg.rfind(':');
+
+    if (colon == std::string::npos) {
+        return PixelFormat::Gray8;
+    }
+
+    PixelFormat format = parsePixelFormat(arg.substr(colon + 1));
+    arg = arg.substr(0, colon);
+
+    return format;
+}
+
+std::unique_ptr<FrameSource> createFrameSource(const std::string &spec)
+{
+    size_t colon = spec.find(':');
+    std::string type = spec.substr(0, colon);
+    std::string arg = colon == std::string::npos ? "" : spec.substr(colon + 1);
+
+    if (type == "left09") {
+        return std::unique_ptr<FrameSource>(new AssetFrameSource());
+    }
+
+    if (type == "synthetic") {
+        int width, height;
+        PixelFormat format = popFormat(arg);
+        parseSize(arg, width, height);
+        return std::unique_ptr<FrameSource>(new SyntheticFrameSource(width, height, format));
+    }
+
+    if (type == "files") {
+        int width = 0, height = 0;
+        PixelFormat format = PixelFormat::Gray8;
+
+        // DIR, DIR:WxH or DIR:WxH:FORMAT
+        size_t last = arg.rfind(':');
+
+        if (last != std::string::npos && arg.find('x', last) == std::string::npos) {
+            format = popFormat(arg);
+            last = arg.rfind(':');
+        }
+
+        if (last != std::string::npos) {
+            parseSize(arg.substr(last + 1), width, height);
+            arg = arg.substr(0, last);
+        }
+
+        return std::unique_ptr<FrameSource>(new FileSequenceFrameSource(arg, true, 30, width, height, format));
+    }
+
+    if (type == "shm") {
+        // shm_open wants a leading slash
+        return std::unique_ptr<FrameSource>(new ShmFrameSource(arg[0] == '/' ? arg : "/" + arg));
+    }
+
+    throw std::runtime_error("Unknown frame source " + spec + ", expected left09, synthetic:WxH, files:DIR or shm:NAME");
+}
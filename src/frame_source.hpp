@@ -0,0 +1,185 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pixel_format.hpp"
+
+// Now on the steady clock, the time base of Frame::timestamp_ns
+int64_t steadyNanoseconds();
+
+// Frame borrowed from a FrameSource. data stays valid until the frame is released.
+struct Frame
+{
+    const unsigned char *data = nullptr;
+    int width = 0;
+    int height = 0;
+    PixelFormat format = PixelFormat::Gray8;
+    int stride = 0; // bytes per row of the first plane, see planeLayout()
+
+    int64_t timestamp_ns = 0; // capture time, steady clock
+    uint64_t sequence = 0; // frame number from the start of the stream
+
+    // owned by the source, identifies the buffer to release
+    uint64_t handle = 0;
+};
+
+// What FrameSource::acquire() got
+enum class AcquireResult
+{
+    Acquired, // the frame is filled in
+    Timeout, // no frame arrived in time, the stream goes on, try again
+    Ended // the stream is over
+};
+
+// Produces camera frames with borrow/return semantics so a source that already has the pixels
+// in memory (mmapped file, shared memory) hands them out without a copy.
+// A source may limit how many frames are borrowed at once, see maxBorrowed().
+class FrameSource
+{
+public:
+    virtual ~FrameSource() {}
+
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+    virtual PixelFormat format() const = 0;
+
+    // Borrow the next frame
+    virtual AcquireResult acquire(Frame &frame) = 0;
+
+    // Hand a frame back, in the order they were acquired
+    virtual void release(const Frame &frame) = 0;
+
+    virtual size_t maxBorrowed() const { return 1; }
+
+    // Sources that make their pixels, rather than lend memory that already holds them, can write
+    // the next frame tightly packed straight into dst instead, eg. the mapped buffer from
+    // FrameUploader::acquire(), which saves copying it there. frame.data is dst and the frame
+    // isn't released.
+    virtual bool canFill() const { return false; }
+    virtual AcquireResult fill(unsigned char *dst, Frame &frame);
+};
+
+// The embedded left09 image, repeated forever at the rate of a typical webcam
+class AssetFrameSource : public FrameSource
+{
+public:
+    explicit AssetFrameSource(double fps = 30);
+
+    int width() const;
+    int height() const;
+    PixelFormat format() const { return PixelFormat::Gray8; }
+
+    AcquireResult acquire(Frame &frame);
+    void release(const Frame &frame) {}
+    size_t maxBorrowed() const { return SIZE_MAX; }
+
+private:
+    double fps_;
+    std::chrono::steady_clock::time_point next_frame_;
+    uint64_t sequence_ = 0;
+};
+
+// Moving gradient for benchmarking, generated into a small ring of buffers as fast as it's acquired.
+// The YUV and Bayer formats get a hue that changes across the image.
+class SyntheticFrameSource : public FrameSource
+{
+public:
+    SyntheticFrameSource(int width, int height, PixelFormat format = PixelFormat::Gray8, size_t num_buffers = 4);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    PixelFormat format() const { return format_; }
+
+    AcquireResult acquire(Frame &frame);
+    void release(const Frame &frame);
+    size_t maxBorrowed() const { return buffers_.size(); }
+
+    bool canFill() const { return true; }
+    AcquireResult fill(unsigned char *dst, Frame &frame);
+
+    // Writes frame number sequence tightly packed to data, eg. straight into FrameUploader::acquire()
+    // without going through the ring
+    void generate(unsigned char *data, uint64_t sequence) const;
+
+private:
+    void generateLuma(unsigned char *data, uint64_t sequence) const;
+    void generateChroma(unsigned char *data) const;
+
+    int width_;
+    int height_;
+    PixelFormat format_;
+
+    std::vector<std::vector<unsigned char>> buffers_;
+    uint64_t sequence_ = 0;
+    uint64_t released_ = 0;
+};
+
+// Sequence of 8-bit binary PGM (.pgm) or headerless raw (.raw) files in a directory, in name order.
+// Each file is mmapped and handed out in place. Raw files need width, height and format up front,
+// they are tightly packed.
+// Frames are handed out fps times a second and stamped with the time they are handed out.
+class FileSequenceFrameSource : public FrameSource
+{
+public:
+    FileSequenceFrameSource(const std::string &dir, bool loop = false, double fps = 30, int raw_width = 0, int raw_height = 0,
+        PixelFormat raw_format = PixelFormat::Gray8);
+    ~FileSequenceFrameSource();
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    PixelFormat format() const { return format_; }
+
+    AcquireResult acquire(Frame &frame);
+    void release(const Frame &frame);
+
+    // Reads the pixels straight from the file into dst, no mapping
+    bool canFill() const { return true; }
+    AcquireResult fill(unsigned char *dst, Frame &frame);
+
+private:
+    struct Mapping
+    {
+        void *addr = nullptr;
+        size_t size = 0;
+        const unsigned char *pixels = nullptr;
+        int width = 0;
+        int height = 0;
+    };
+
+    // Offset of the pixels in a file of size bytes starting with header, throws if it's malformed
+    size_t pixelOffset(const std::string &filename, const unsigned char *header, size_t header_size, size_t size,
+        int &width, int &height) const;
+
+    Mapping map(const std::string &filename) const;
+    static void unmap(Mapping &mapping);
+
+    // Next file, or false at the end, paced to fps
+    bool nextFile(std::string &filename);
+    void fillFrame(Frame &frame, const unsigned char *data);
+
+    std::vector<std::string> files_;
+    bool loop_;
+    double fps_;
+    std::chrono::steady_clock::time_point next_frame_;
+    int raw_width_;
+    int raw_height_;
+    PixelFormat raw_format_;
+
+    int width_ = 0;
+    int height_ = 0;
+    PixelFormat format_ = PixelFormat::Gray8;
+
+    Mapping current_;
+    uint64_t sequence_ = 0;
+};
+
+// spec is one of the following, FORMAT is a pixelFormatName()
+//   left09                         the embedded image
+//   synthetic:WxH[:FORMAT]         generated frames
+//   files:DIR[:WxH[:FORMAT]]       PGM/raw sequence, see FileSequenceFrameSource, size and format are for raw files
+//   shm:NAME                       POSIX shared memory ring, see ShmFrameSource
+std::unique_ptr<FrameSource> createFrameSource(const std::string &spec);
@@ -0,0 +1,45 @@
+#include "frame_stats.hpp"
+
+static double elapsedMs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+FrameStats::FrameStats(double report_interval) :
+    report_interval_(report_interval),
+    interval_start_(Clock::now())
+{
+}
+
+void FrameStats::beginUpload()
+{
+    upload_start_ = Clock::now();
+}
+
+void FrameStats::endUpload()
+{
+    upload_total_ms_ += elapsedMs(upload_start_, Clock::now());
+    uploads_++;
+}
+
+bool FrameStats::frame()
+{
+    frames_++;
+
+    Clock::time_point now = Clock::now();
+    double elapsed_ms = elapsedMs(interval_start_, now);
+
+    if (elapsed_ms < report_interval_ * 1000.0) {
+        return false;
+    }
+
+    fps_ = frames_ * 1000.0 / elapsed_ms;
+    upload_ms_ = uploads_ > 0 ? upload_total_ms_ / uploads_ : 0.0;
+
+    frames_ = 0;
+    uploads_ = 0;
+    upload_total_ms_ = 0;
+    interval_start_ = now;
+
+    return true;
+}
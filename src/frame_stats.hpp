@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+
+// Frames-per-second and upload latency counter.
+// Averages are taken over report_interval seconds.
+class FrameStats
+{
+public:
+    explicit FrameStats(double report_interval = 1.0);
+
+    void beginUpload();
+    void endUpload();
+
+    // Call once per rendered frame. Returns true when a new report is ready.
+    bool frame();
+
+    double fps() const { return fps_; }
+    double uploadMs() const { return upload_ms_; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    double report_interval_;
+
+    Clock::time_point interval_start_;
+    Clock::time_point upload_start_;
+
+    int frames_ = 0;
+    int uploads_ = 0;
+    double upload_total_ms_ = 0;
+
+    double fps_ = 0;
+    double upload_ms_ = 0;
+};
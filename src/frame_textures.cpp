@@ -0,0 +1,111 @@
+#include <stdexcept>
+
+#include "frame_textures.hpp"
+#include "opengl_helper.hpp"
+
+static GLenum textureFormat(PixelFormat format, const PlaneLayout &plane)
+{
+    if (format == PixelFormat::Gray16UI) {
+        return GL_RED_INTEGER;
+    }
+
+    switch (plane.channels) {
+        case 1:
+            return GL_RED;
+        case 2:
+            return GL_RG;
+        case 4:
+            return GL_RGBA;
+        default:
+            throw std::runtime_error("Unsupported number of channels " + std::to_string(plane.channels));
+    }
+}
+
+static GLint internalFormat(PixelFormat format, const PlaneLayout &plane)
+{
+    switch (format) {
+        case PixelFormat::Gray16UI:
+            return GL_R16UI;
+        case PixelFormat::Gray32F:
+            return GL_R32F;
+        default:
+            break;
+    }
+
+    if (plane.bytes_per_channel == 2) {
+        return plane.channels == 1 ? GL_R16 : plane.channels == 2 ? GL_RG16 : GL_RGBA16;
+    }
+
+    return plane.channels == 1 ? GL_R8 : plane.channels == 2 ? GL_RG8 : GL_RGBA8;
+}
+
+static GLenum textureType(PixelFormat format, const PlaneLayout &plane)
+{
+    if (format == PixelFormat::Gray32F) {
+        return GL_FLOAT;
+    }
+
+    return plane.bytes_per_channel == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+}
+
+FrameTextures::FrameTextures(int width, int height, PixelFormat format) :
+    width_(width),
+    height_(height),
+    format_(format),
+    planes_(planeLayout(format, width, height))
+{
+    std::vector<unsigned char> black = blackFrame(format, width, height);
+
+    textures_.resize(planes_.size());
+    GL_CHECK(glGenTextures(textures_.size(), textures_.data()));
+    GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+    for (size_t i = 0; i < planes_.size(); i++) {
+        const PlaneLayout &plane = planes_[i];
+
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, textures_[i]));
+        GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, internalFormat(format, plane), plane.width, plane.height, 0,
+            textureFormat(format, plane), textureType(format, plane), black.data() + plane.offset));
+
+        // filtering across a Bayer mosaic mixes colors, it is only ever read texel by texel,
+        // and integer textures can't be filtered at all
+        GLint filter = isBayer(format) || format == PixelFormat::Gray16UI ? GL_NEAREST : GL_LINEAR;
+
+        GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter));
+        GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter));
+    }
+
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+FrameTextures::~FrameTextures()
+{
+    glDeleteTextures(textures_.size(), textures_.data());
+}
+
+void FrameTextures::update(size_t offset)
+{
+    GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+    for (size_t i = 0; i < planes_.size(); i++) {
+        const PlaneLayout &plane = planes_[i];
+
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, textures_[i]));
+        GL_CHECK(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, plane.width, plane.height, textureFormat(format_, plane), textureType(format_, plane),
+            reinterpret_cast<const void*>(offset + plane.offset)));
+    }
+
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+void FrameTextures::bind() const
+{
+    for (size_t i = 0; i < textures_.size(); i++) {
+        GL_CHECK(glActiveTexture(GL_TEXTURE0 + textureUnit(i)));
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, textures_[i]));
+    }
+
+    GL_CHECK(glActiveTexture(GL_TEXTURE0));
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+#include "pixel_format.hpp"
+
+// One texture per plane of a camera frame, allocated once and updated in place. The planes are
+// stored as they come, any color conversion is left to the shader.
+class FrameTextures
+{
+public:
+    // Cleared to black
+    FrameTextures(int width, int height, PixelFormat format);
+    ~FrameTextures();
+
+    FrameTextures(const FrameTextures&) = delete;
+    FrameTextures& operator=(const FrameTextures&) = delete;
+
+    // Update every plane from a tightly packed frame at offset in the bound GL_PIXEL_UNPACK_BUFFER,
+    // or at offset from address 0 with no buffer bound. Asynchronous with a buffer bound.
+    void update(size_t offset);
+
+    // Bind each plane to its textureUnit()
+    void bind() const;
+
+    // Plane 0 goes on unit 0, the others on 2 and up since unit 1 holds the undistort remap
+    static int textureUnit(size_t plane) { return plane == 0 ? 0 : plane + 1; }
+
+    GLuint plane(size_t i) const { return textures_[i]; }
+    size_t numPlanes() const { return textures_.size(); }
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    PixelFormat format() const { return format_; }
+
+private:
+    int width_;
+    int height_;
+    PixelFormat format_;
+
+    std::vector<PlaneLayout> planes_;
+    std::vector<GLuint> textures_;
+};
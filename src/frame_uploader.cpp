@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "frame_uploader.hpp"
+#include "opengl_helper.hpp"
+
+FrameUploader::FrameUploader(int width, int height, PixelFormat format) :
+    width_(width),
+    height_(height),
+    format_(format),
+    frame_size_(frameSize(format, width, height)),
+    textures_(width, height, format)
+{
+}
+
+FrameUploader::~FrameUploader()
+{
+}
+
+void FrameUploader::upload(const unsigned char *data, int stride)
+{
+    unsigned char *ptr = acquire();
+    copyFrame(ptr, data, format_, width_, height_, stride);
+    submit();
+}
+
+void FrameUploader::transfer(size_t offset)
+{
+    // Asynchronous, glTexSubImage2D returns as soon as the DMA is queued
+    textures_.update(offset);
+}
+
+PboFrameUploader::PboFrameUploader(int width, int height, PixelFormat format, int num_buffers) :
+    FrameUploader(width, height, format)
+{
+    if (num_buffers < 1) {
+        throw std::runtime_error("PboFrameUploader needs at least one buffer");
+    }
+
+    pbo_.resize(num_buffers);
+    GL_CHECK(glGenBuffers(num_buffers, pbo_.data()));
+
+    for (GLuint pbo : pbo_) {
+        GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo));
+        GL_CHECK(glBufferData(GL_PIXEL_UNPACK_BUFFER, frame_size_, nullptr, GL_STREAM_DRAW));
+    }
+
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+}
+
+PboFrameUploader::~PboFrameUploader()
+{
+    glDeleteBuffers(pbo_.size(), pbo_.data());
+}
+
+unsigned char *PboFrameUploader::acquire()
+{
+    // Orphan the buffer we are about to write so the driver doesn't stall on a pending transfer
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[index_]));
+    GL_CHECK(glBufferData(GL_PIXEL_UNPACK_BUFFER, frame_size_, nullptr, GL_STREAM_DRAW));
+
+    void *ptr = nullptr;
+    GL_CHECK(ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, frame_size_, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+    if (!ptr) {
+        throw std::runtime_error("PboFrameUploader: glMapBufferRange failed");
+    }
+
+    return static_cast<unsigned char*>(ptr);
+}
+
+void PboFrameUploader::submit()
+{
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[index_]));
+    GL_CHECK(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+
+    index_ = (index_ + 1) % pbo_.size();
+    num_filled_++;
+
+    // Transfer the oldest filled PBO, which is the one we write next
+    if (num_filled_ >= pbo_.size()) {
+        GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[index_]));
+        transfer(0);
+    }
+
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+}
+
+PersistentFrameUploader::PersistentFrameUploader(int width, int height, PixelFormat format, int num_slots) :
+    FrameUploader(width, height, format),
+    fences_(num_slots, nullptr)
+{
+    if (num_slots < 1) {
+        throw std::runtime_error("PersistentFrameUploader needs at least one slot");
+    }
+
+    if (!isSupported()) {
+        throw std::runtime_error("PersistentFrameUploader requires ARB_buffer_storage");
+    }
+
+    // Every slot starts at a multiple of the map alignment and at least a cache line. That keeps the
+    // transfer offset a multiple of the sample size, which GL requires for 16-bit and float frames,
+    // and lets the CPU write whole cache lines.
+    GLint alignment = 0;
+    GL_CHECK(glGetIntegerv(GL_MIN_MAP_BUFFER_ALIGNMENT, &alignment));
+    alignment = std::max(alignment, 64);
+    slot_size_ = (frame_size_ + alignment - 1) / alignment * alignment;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr size = slot_size_ * num_slots;
+
+    GL_CHECK(glGenBuffers(1, &buffer_));
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer_));
+    GL_CHECK(glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags));
+
+    GL_CHECK(mapped_ = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags)));
+
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+    if (!mapped_) {
+        glDeleteBuffers(1, &buffer_);
+        throw std::runtime_error("PersistentFrameUploader: glMapBufferRange failed");
+    }
+}
+
+PersistentFrameUploader::~PersistentFrameUploader()
+{
+    for (GLsync fence : fences_) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer_);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &buffer_);
+}
+
+bool PersistentFrameUploader::isSupported()
+{
+    return GLEW_ARB_buffer_storage;
+}
+
+unsigned char *PersistentFrameUploader::acquire()
+{
+    GLsync &fence = fences_[index_];
+
+    // Wait until the GPU is done reading this slot. Only blocks if the producer is
+    // more than num_slots frames ahead of the GPU. A slow frame (driver hiccup, debugger)
+    // only delays it, the slot is still going to be freed.
+    if (fence) {
+        GLenum ret;
+        GL_CHECK(ret = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000));
+
+        while (ret == GL_TIMEOUT_EXPIRED) {
+            std::cerr << "PersistentFrameUploader: still waiting for the GPU to free a slot\n";
+            GL_CHECK(ret = glClientWaitSync(fence, 0, 1000000000));
+        }
+
+        if (ret == GL_WAIT_FAILED) {
+            throw std::runtime_error("PersistentFrameUploader: glClientWaitSync failed");
+        }
+
+        GL_CHECK(glDeleteSync(fence));
+        fence = nullptr;
+    }
+
+    return mapped_ + index_ * slot_size_;
+}
+
+void PersistentFrameUploader::submit()
+{
+    // The mapping is coherent, so the writes are visible to the GPU without a flush
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer_));
+    transfer(index_ * slot_size_);
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+    GL_CHECK(fences_[index_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+    index_ = (index_ + 1) % fences_.size();
+}
+
+std::unique_ptr<FrameUploader> createFrameUploader(int width, int height, PixelFormat format, int num_buffers)
+{
+    if (PersistentFrameUploader::isSupported()) {
+        try {
+            // one more slot than PBOs since the persistent path has no frame of lag to hide behind
+            return std::unique_ptr<FrameUploader>(new PersistentFrameUploader(width, height, format, num_buffers + 1));
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << ", falling back to PBO upload\n";
+        }
+    }
+
+    return std::unique_ptr<FrameUploader>(new PboFrameUploader(width, height, format, num_buffers));
+}
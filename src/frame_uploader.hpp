@@ -0,0 +1,100 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <memory>
+#include <vector>
+
+#include "frame_textures.hpp"
+#include "pixel_format.hpp"
+
+// Streams camera frames into FrameTextures, one texture per plane. The textures are allocated
+// once and updated with glTexSubImage2D, so there is no reallocation per frame.
+//
+// Frames can be written straight into driver memory with acquire()/submit(), or copied
+// in with upload(). acquire() and submit() must be called on the GL thread, but the
+// returned pointer can be filled from any thread in between.
+class FrameUploader
+{
+public:
+    virtual ~FrameUploader();
+
+    FrameUploader(const FrameUploader&) = delete;
+    FrameUploader& operator=(const FrameUploader&) = delete;
+
+    // Returns where to write the next tightly packed width x height frame, see planeLayout()
+    virtual unsigned char *acquire() = 0;
+
+    // Hands the frame written since acquire() over to the texture
+    virtual void submit() = 0;
+
+    virtual const char *name() const = 0;
+
+    // Convenience for frames that already live in CPU memory, stride is bytes per row of the
+    // first plane (0 for tightly packed)
+    void upload(const unsigned char *data, int stride = 0);
+
+    const FrameTextures &textures() const { return textures_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    PixelFormat format() const { return format_; }
+
+protected:
+    FrameUploader(int width, int height, PixelFormat format);
+
+    // Update the textures from the currently bound GL_PIXEL_UNPACK_BUFFER
+    void transfer(size_t offset);
+
+    int width_;
+    int height_;
+    PixelFormat format_;
+    size_t frame_size_;
+
+    FrameTextures textures_;
+};
+
+// Ring of pixel unpack buffers (PBO). While the GPU transfers frame N out of one PBO the
+// CPU is writing frame N+1 into the next, hence the texture lags the last submit() by
+// num_buffers - 1 frames.
+class PboFrameUploader : public FrameUploader
+{
+public:
+    PboFrameUploader(int width, int height, PixelFormat format = PixelFormat::Gray8, int num_buffers = 2);
+    ~PboFrameUploader();
+
+    unsigned char *acquire();
+    void submit();
+    const char *name() const { return "pbo"; }
+
+private:
+    std::vector<GLuint> pbo_;
+    size_t index_ = 0;
+    size_t num_filled_ = 0;
+};
+
+// One persistently and coherently mapped buffer (ARB_buffer_storage) split into
+// num_slots frames. The producer writes directly into driver memory, so there is no
+// memcpy on the CPU at all. Each slot is guarded by a fence that signals once the
+// texture transfer reading from it has completed.
+class PersistentFrameUploader : public FrameUploader
+{
+public:
+    PersistentFrameUploader(int width, int height, PixelFormat format = PixelFormat::Gray8, int num_slots = 3);
+    ~PersistentFrameUploader();
+
+    unsigned char *acquire();
+    void submit();
+    const char *name() const { return "persistent"; }
+
+    static bool isSupported();
+
+private:
+    GLuint buffer_ = 0;
+    unsigned char *mapped_ = nullptr;
+    size_t slot_size_ = 0; // frame_size_ rounded up to the slot alignment
+    std::vector<GLsync> fences_;
+    size_t index_ = 0;
+};
+
+// Uses PersistentFrameUploader when ARB_buffer_storage is available, otherwise falls
+// back to PboFrameUploader
+std::unique_ptr<FrameUploader> createFrameUploader(int width, int height, PixelFormat format = PixelFormat::Gray8, int num_buffers = 2);
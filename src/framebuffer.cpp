@@ -0,0 +1,48 @@
+#include <stdexcept>
+#include <string>
+
+#include "framebuffer.hpp"
+#include "opengl_helper.hpp"
+
+Framebuffer::Framebuffer(int width, int height) :
+    width_(width),
+    height_(height)
+{
+    GL_CHECK(glGenRenderbuffers(1, &color_));
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, color_));
+    GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height));
+
+    GL_CHECK(glGenRenderbuffers(1, &depth_));
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, depth_));
+    GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height));
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+    GL_CHECK(glGenFramebuffers(1, &fbo_));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo_));
+    GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_));
+    GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_));
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error("Framebuffer incomplete, status " + std::to_string(status));
+    }
+}
+
+Framebuffer::~Framebuffer()
+{
+    glDeleteFramebuffers(1, &fbo_);
+    glDeleteRenderbuffers(1, &color_);
+    glDeleteRenderbuffers(1, &depth_);
+}
+
+void Framebuffer::bind()
+{
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo_));
+}
+
+void Framebuffer::unbind()
+{
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// Offscreen render target with an RGBA8 color and 32-bit float depth renderbuffer, float so
+// DepthMode::ReversedZ keeps its precision
+class Framebuffer
+{
+public:
+    Framebuffer(int width, int height);
+    ~Framebuffer();
+
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    void bind();
+    static void unbind();
+
+    GLuint id() const { return fbo_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+private:
+    int width_;
+    int height_;
+
+    GLuint fbo_ = 0;
+    GLuint color_ = 0;
+    GLuint depth_ = 0;
+};
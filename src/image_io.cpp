@@ -0,0 +1,115 @@
+#include <dirent.h>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "image_io.hpp"
+
+// Next whitespace separated header token, skipping # comments
+static std::string headerToken(std::istream &in)
+{
+    std::string token;
+
+    while (in >> token) {
+        if (token[0] != '#') {
+            return token;
+        }
+
+        std::getline(in, token);
+    }
+
+    throw std::runtime_error("Truncated PNM header");
+}
+
+Image loadPGM(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    if (!file) {
+        throw std::runtime_error("Can't open " + filename);
+    }
+
+    if (headerToken(file) != "P5") {
+        throw std::runtime_error(filename + " is not a binary PGM");
+    }
+
+    Image image;
+    image.width = std::stoi(headerToken(file));
+    image.height = std::stoi(headerToken(file));
+    image.channels = 1;
+
+    if (std::stoi(headerToken(file)) != 255) {
+        throw std::runtime_error(filename + " is not an 8-bit PGM");
+    }
+
+    // single whitespace before the pixels
+    file.get();
+
+    image.data.resize(static_cast<size_t>(image.width) * image.height);
+    file.read(reinterpret_cast<char*>(image.data.data()), image.data.size());
+
+    if (!file) {
+        throw std::runtime_error(filename + " is truncated");
+    }
+
+    return image;
+}
+
+void savePPM(const std::string &filename, const Image &image, bool flip_y)
+{
+    if (image.channels != 3 && image.channels != 4) {
+        throw std::runtime_error("savePPM needs an RGB or RGBA image");
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+
+    if (!file) {
+        throw std::runtime_error("Can't write " + filename);
+    }
+
+    file << "P6\n" << image.width << " " << image.height << "\n255\n";
+
+    std::vector<char> row(image.width * 3);
+    size_t stride = static_cast<size_t>(image.width) * image.channels;
+
+    for (int y = 0; y < image.height; y++) {
+        const unsigned char *src = image.data.data() + (flip_y ? image.height - 1 - y : y) * stride;
+
+        for (int x = 0; x < image.width; x++) {
+            row[x*3 + 0] = src[x*image.channels + 0];
+            row[x*3 + 1] = src[x*image.channels + 1];
+            row[x*3 + 2] = src[x*image.channels + 2];
+        }
+
+        file.write(row.data(), row.size());
+    }
+
+    if (!file) {
+        throw std::runtime_error("Failed writing " + filename);
+    }
+}
+
+std::vector<std::string> listFiles(const std::string &dir, const std::string &extension)
+{
+    DIR *d = opendir(dir.c_str());
+
+    if (!d) {
+        throw std::runtime_error("Can't open directory " + dir);
+    }
+
+    std::vector<std::string> files;
+
+    while (dirent *entry = readdir(d)) {
+        std::string name = entry->d_name;
+
+        if (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0) {
+            files.push_back(dir + "/" + name);
+        }
+    }
+
+    closedir(d);
+    std::sort(files.begin(), files.end());
+
+    return files;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// 8-bit image, rows top to bottom, channels interleaved with no row padding
+struct Image
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<unsigned char> data;
+};
+
+// Binary PGM (P5) with maxval 255. Throws on anything else.
+Image loadPGM(const std::string &filename);
+
+// Binary PPM (P6) from an RGB or RGBA image, alpha is dropped. flip_y writes the rows bottom
+// to top, for pixels straight out of glReadPixels.
+void savePPM(const std::string &filename, const Image &image, bool flip_y = false);
+
+// Files in dir ending with extension, sorted by name
+std::vector<std::string> listFiles(const std::string &dir, const std::string &extension);
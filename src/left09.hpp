@@ -1,6 +1,8 @@
 #pragma once
 
-// left09.jpg from OpenCV sample directory converted to raw char array
+// left09.jpg from OpenCV sample directory converted to a raw asset pack, assets/left09.pack.
+// It is memory-mapped on first use from the assets directory next to the executable, or
+// $OPENCV_GL_ASSET_DIR, or linked into the binary when built with EMBED_ASSETS.
 int left09_width();
 int left09_height();
-const unsigned char *left09_data();
\ No newline at end of file
+const unsigned char *left09_data();
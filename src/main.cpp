@@ -1,34 +1,549 @@
 #include <GL/glew.h>
-#include <GLFW/glfw3.h>
 
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "opengl_helper.hpp"
-#include "shader.hpp"
 #include "left09.hpp"
+#include "frame_uploader.hpp"
+#include "frame_stats.hpp"
+#include "camera_model.hpp"
+#include "calibration_io.hpp"
+#include "pose_io.hpp"
+#include "rodrigues.hpp"
+#include "pose_buffer.hpp"
+#include "display_timer.hpp"
+#include "distortion.hpp"
+#include "framebuffer.hpp"
+#include "mesh.hpp"
+#include "point_projector.hpp"
+#include "software_rasterizer.hpp"
+#include "overlay_renderer.hpp"
+#include "render_context.hpp"
+#include "frame_readback.hpp"
+#include "blocking_queue.hpp"
+#include "image_io.hpp"
+#include "frame_source.hpp"
+#include "capture_thread.hpp"
+#include "upload_worker.hpp"
+
+// Per-frame cost of undistorting every background pixel vs distorting the overlay geometry,
+// rendered offscreen at increasing resolutions. Intrinsics are scaled from the 640x480 calibration.
+static void benchmarkDistortion(const Mesh &mesh, const glm::mat4 &model, const CameraModel &camera)
+{
+    struct Resolution
+    {
+        int width;
+        int height;
+    };
+
+    const Resolution resolutions[] = {{640, 480}, {1920, 1080}, {3840, 2160}};
+
+    // typical barrel distortion of a webcam lens
+    DistortionCoeffs dist;
+    dist.k1 = -0.28f;
+    dist.k2 = 0.07f;
+    dist.p1 = 0.0018f;
+    dist.p2 = -0.0003f;
+    dist.k3 = 0.0f;
+
+    constexpr int warmup_frames = 10;
+    constexpr int frames = 200;
+
+    CameraModel distorted = camera;
+    distorted.setDistortion(dist);
+
+    for (const Resolution &res : resolutions) {
+        Framebuffer framebuffer(res.width, res.height);
+        std::unique_ptr<FrameUploader> uploader = createFrameUploader(res.width, res.height);
+        OverlayRenderer renderer(res.width, res.height, mesh);
+        renderer.setCamera(distorted);
+
+        std::vector<unsigned char> image(res.width * res.height);
+
+        for (size_t i = 0; i < image.size(); i++) {
+            image[i] = i % 251;
+        }
+
+        const DistortionMode modes[] = {DistortionMode::UndistortImage, DistortionMode::DistortGeometry};
+        const char *names[] = {"undistort image", "distort geometry"};
+
+        for (int m = 0; m < 2; m++) {
+            renderer.setDistortionMode(modes[m]);
+            framebuffer.bind();
+
+            std::chrono::steady_clock::time_point start;
+
+            for (int i = 0; i < warmup_frames + frames; i++) {
+                if (i == warmup_frames) {
+                    GL_CHECK(glFinish());
+                    start = std::chrono::steady_clock::now();
+                }
+
+                uploader->upload(image.data());
+                renderer.draw(uploader->textures(), model, res.width, res.height);
+            }
+
+            GL_CHECK(glFinish());
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << res.width << "x" << res.height << " " << names[m] << ": " << ms / frames << " ms/frame\n";
+        }
 
-static void error_callback(int error, const char* description)
+        Framebuffer::unbind();
+    }
+}
+
+// CPU submit time and frame time of the instanced draw path from 1 to 100k cuboids against one
+// draw call per cuboid, scattered in front of the camera with the board orientation
+static void benchmarkInstances(const Mesh &mesh, const glm::mat4 &model, const CameraModel &camera)
+{
+    const int width = left09_width();
+    const int height = left09_height();
+
+    Framebuffer framebuffer(width, height);
+    std::unique_ptr<FrameUploader> uploader = createFrameUploader(width, height);
+    OverlayRenderer renderer(width, height, mesh);
+    renderer.setCamera(camera);
+    uploader->upload(left09_data());
+
+    framebuffer.bind();
+
+    for (int count = 1; count <= 100000; count *= 10) {
+        std::vector<OverlayInstance> instances(count);
+        unsigned int seed = 1;
+
+        // cheap LCG, repeatable between runs
+        auto rand01 = [&seed]() {
+            seed = seed*1664525u + 1013904223u;
+            return (seed >> 8) / 16777216.0f;
+        };
+
+        for (OverlayInstance &instance : instances) {
+            instance.model = model;
+            instance.model[3][0] = (rand01() - 0.5f) * 0.6f;
+            instance.model[3][1] = (rand01() - 0.5f) * 0.4f;
+            instance.model[3][2] = 0.3f + rand01() * 1.5f;
+            instance.color = glm::vec4(rand01(), rand01(), rand01(), 1.0f);
+        }
+
+        // fewer frames for the big counts, a software rasterizer takes seconds for each
+        int frames = std::min(100, std::max(10, 1000000 / count));
+
+        for (int instanced = 1; instanced >= 0; instanced--) {
+            double submit_ms = 0;
+
+            GL_CHECK(glFinish());
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < frames; i++) {
+                std::chrono::steady_clock::time_point submit_start = std::chrono::steady_clock::now();
+
+                if (instanced) {
+                    renderer.draw(uploader->textures(), instances, width, height);
+                } else {
+                    renderer.drawPerInstance(uploader->textures(), instances, width, height);
+                }
+
+                submit_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submit_start).count();
+            }
+
+            GL_CHECK(glFinish());
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << count << (instanced ? " instances, instanced" : " instances, per draw") << ": submit "
+                << submit_ms / frames << " ms, frame " << ms / frames << " ms\n";
+        }
+    }
+
+    Framebuffer::unbind();
+}
+
+// Render-thread frame time with the texture upload on the render thread vs on an UploadWorker,
+// 1080p frames from an unpaced synthetic source. Each frame is finished before the next so the
+// GPU time counts too. Reports the mean, the standard deviation and the worst frames.
+static void benchmarkUpload(RenderContext &context, const Mesh &mesh, const glm::mat4 &model, const CameraModel &camera)
 {
-    std::cerr << "glfw error: " << description << "\n";
+    const int width = 1920;
+    const int height = 1080;
+
+    constexpr int warmup_frames = 30;
+    constexpr int frames = 300;
+
+    Framebuffer framebuffer(width, height);
+    OverlayRenderer renderer(width, height, mesh);
+    renderer.setCamera(camera);
+
+    for (int threaded = 0; threaded < 2; threaded++) {
+        CaptureThread capture(std::unique_ptr<FrameSource>(new SyntheticFrameSource(width, height)), QueuePolicy::Latest);
+        std::unique_ptr<FrameUploader> uploader;
+        std::unique_ptr<UploadWorker> worker;
+
+        if (threaded) {
+            worker.reset(new UploadWorker(context, capture));
+        } else {
+            uploader = createFrameUploader(width, height);
+        }
+
+        std::vector<double> frame_ms;
+        framebuffer.bind();
+        GL_CHECK(glFinish());
+
+        for (int i = 0; i < warmup_frames + frames; i++) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            const FrameTextures *image;
+
+            if (worker) {
+                image = &worker->textures();
+            } else {
+                Frame frame;
+
+                if (capture.next(frame)) {
+                    uploader->upload(frame.data, frame.stride);
+                    capture.release(frame);
+                }
+
+                image = &uploader->textures();
+            }
+
+            renderer.draw(*image, model, width, height);
+            GL_CHECK(glFinish());
+
+            if (i >= warmup_frames) {
+                frame_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            }
+        }
+
+        Framebuffer::unbind();
+
+        double mean = 0;
+        double variance = 0;
+
+        for (double ms : frame_ms) {
+            mean += ms / frame_ms.size();
+        }
+
+        for (double ms : frame_ms) {
+            variance += (ms - mean) * (ms - mean) / frame_ms.size();
+        }
+
+        std::sort(frame_ms.begin(), frame_ms.end());
+
+        std::cout << (threaded ? "upload worker" : "render thread upload") << ": mean " << mean << " ms, stddev " << std::sqrt(variance)
+            << " ms, p99 " << frame_ms[frame_ms.size() * 99 / 100] << " ms, max " << frame_ms.back() << " ms\n";
+    }
+}
+
+// Upload throughput of each pixel format at 1080p through the render thread uploader. The synthetic
+// source either generates each frame into its own memory and upload() copies it into the mapped
+// buffer, or generates it in place into acquire() and submits it, which saves the copy.
+static void benchmarkUploadFormats()
+{
+    const int width = 1920;
+    const int height = 1080;
+
+    constexpr int warmup_frames = 30;
+    constexpr int frames = 300;
+
+    const PixelFormat formats[] = {PixelFormat::Gray8, PixelFormat::Gray16, PixelFormat::Gray16UI, PixelFormat::Gray32F,
+        PixelFormat::NV12, PixelFormat::YUYV, PixelFormat::BayerRGGB16};
+
+    for (PixelFormat format : formats) {
+        std::unique_ptr<FrameUploader> uploader = createFrameUploader(width, height, format);
+        SyntheticFrameSource source(width, height, format);
+        double mb = frameSize(format, width, height) / 1e6;
+
+        for (int in_place = 0; in_place < 2; in_place++) {
+            std::chrono::steady_clock::time_point start;
+
+            for (int i = 0; i < warmup_frames + frames; i++) {
+                if (i == warmup_frames) {
+                    GL_CHECK(glFinish());
+                    start = std::chrono::steady_clock::now();
+                }
+
+                if (in_place) {
+                    source.generate(uploader->acquire(), i);
+                    uploader->submit();
+                } else {
+                    Frame frame;
+                    source.acquire(frame);
+                    uploader->upload(frame.data, frame.stride);
+                    source.release(frame);
+                }
+            }
+
+            GL_CHECK(glFinish());
+
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << pixelFormatName(format) << (in_place ? " in place: " : " upload: ") << mb << " MB/frame, "
+                << seconds * 1000 / frames << " ms/frame, " << mb * frames / seconds << " MB/s\n";
+        }
+    }
+}
+
+// CPU projection throughput in points/sec for each SIMD level over 1k to 10M points, then thread
+// scaling on the largest batch. Points are spread over the cuboid in front of the camera.
+static void benchmarkProjection(const glm::mat4 &model, const CameraModel &camera)
+{
+    const size_t max_points = 10000000;
+
+    std::vector<float> x(max_points), y(max_points), z(max_points);
+    std::vector<float> u(max_points), v(max_points), depth(max_points);
+    std::vector<float> u_scalar(max_points), v_scalar(max_points);
+
+    for (size_t i = 0; i < max_points; i++) {
+        x[i] = (i % 1000) * 1e-4f;
+        y[i] = (i / 1000 % 1000) * 1e-4f;
+        z[i] = -(i % 7) * 0.01f;
+    }
+
+    PointProjector projector = camera.projector(model);
+
+    // repeat small batches so every measurement covers about the same number of points
+    auto measure = [&](size_t count, unsigned threads) {
+        int repeats = std::max<size_t>(1, max_points / count);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < repeats; i++) {
+            projector.projectParallel(x.data(), y.data(), z.data(), count, u.data(), v.data(), depth.data(), threads);
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        return count * repeats / seconds;
+    };
+
+    projector.setSimdLevel(SimdLevel::Scalar);
+    projector.project(x.data(), y.data(), z.data(), max_points, u_scalar.data(), v_scalar.data());
+
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2}) {
+        if (!PointProjector::isSupported(level)) {
+            std::cout << PointProjector::simdLevelName(level) << ": not supported\n";
+            continue;
+        }
+
+        projector.setSimdLevel(level);
+
+        for (size_t count = 1000; count <= max_points; count *= 10) {
+            std::cout << PointProjector::simdLevelName(level) << ", " << count << " points: "
+                << measure(count, 1) / 1e6 << " Mpoints/s\n";
+        }
+
+        // the SIMD paths should match the scalar one exactly
+        projector.project(x.data(), y.data(), z.data(), max_points, u.data(), v.data());
+        size_t mismatches = 0;
+
+        for (size_t i = 0; i < max_points; i++) {
+            mismatches += u[i] != u_scalar[i] || v[i] != v_scalar[i];
+        }
+
+        std::cout << PointProjector::simdLevelName(level) << ": " << mismatches << " points differ from scalar\n";
+    }
+
+    projector.setSimdLevel(PointProjector::bestSimdLevel());
+
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        std::cout << PointProjector::simdLevelName(projector.simdLevel()) << ", " << max_points << " points, " << threads << " threads: "
+            << measure(max_points, threads) / 1e6 << " Mpoints/s\n";
+    }
 }
 
-static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+// Frame time of SoftwareRasterizer drawing the overlay on a synthetic image at 640x480 and 1080p,
+// on one thread and on every core. Intrinsics are scaled from the 640x480 calibration.
+static void benchmarkSoftware(const Mesh &mesh, const glm::mat4 &model, const CameraModel &camera)
 {
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, GLFW_TRUE);
+    struct Resolution
+    {
+        int width;
+        int height;
+    };
+
+    const Resolution resolutions[] = {{640, 480}, {1920, 1080}};
+
+    constexpr int warmup_frames = 5;
+    constexpr int frames = 50;
+
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (const Resolution &res : resolutions) {
+        SoftwareRasterizer rasterizer(res.width, res.height, mesh);
+        rasterizer.setCamera(camera);
+
+        std::vector<unsigned char> image(res.width * res.height);
+
+        for (size_t i = 0; i < image.size(); i++) {
+            image[i] = i % 251;
+        }
+
+        Image out;
+
+        for (unsigned threads : {1u, max_threads}) {
+            rasterizer.setNumThreads(threads);
+
+            std::chrono::steady_clock::time_point start;
+
+            for (int i = 0; i < warmup_frames + frames; i++) {
+                if (i == warmup_frames) {
+                    start = std::chrono::steady_clock::now();
+                }
+
+                rasterizer.draw(image.data(), res.width, res.height, model, res.width, res.height, out);
+            }
+
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << res.width << "x" << res.height << " software, " << threads << " threads: " << ms / frames << " ms/frame, "
+                << frames * 1000 / ms << " frames/s\n";
+
+            if (max_threads == 1) {
+                break;
+            }
+        }
     }
 }
 
-int main(void)
+int main(int argc, char **argv)
 {
+    std::chrono::steady_clock::time_point startup = std::chrono::steady_clock::now();
+
+    bool bench_distortion = false;
+    bool bench_instances = false;
+    bool bench_upload = false;
+    bool bench_projection = false;
+    bool bench_software = false;
+    bool upload_thread = true;
+    bool shader_cache = true;
+    bool vsync = true;
+    bool pose_prediction = true;
+    std::string backend = "glfw";
+    std::string record_dir;
+    std::string source_spec = "left09";
+    std::string calibration_file;
+    std::string pose_file;
+    std::string pose_cache_dir;
+    QueuePolicy queue_policy = QueuePolicy::Latest;
+    YuvColorSpace color_space = YuvColorSpace::BT601;
+    DemosaicMethod demosaic_method = DemosaicMethod::MalvarHeCutler;
+    DistortionMode distortion_mode = DistortionMode::None;
+    bool distortion_set = false;
+    DepthMode depth_mode = DepthMode::Standard;
+    float window = 0;
+    float level = 0;
+    long max_frames = -1;
+    double pose_rate = 30;
+
+    // extrinsics for opencv/samples/data/left09.jpg, rvec and tvec as output by the calibration
+    double board_rvec[3] = {2.0300398779900114e-01, -4.2410496884534077e-01, 1.3245976197201628e-01};
+    double board_tvec[3] = {-5.3109423342047581e-02, -6.4807198552484332e-02, 2.2278644271121698e-01};
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--bench-distortion") == 0) {
+            bench_distortion = true;
+        } else if (std::strcmp(argv[i], "--bench-instances") == 0) {
+            bench_instances = true;
+        } else if (std::strcmp(argv[i], "--bench-upload") == 0) {
+            bench_upload = true;
+        } else if (std::strcmp(argv[i], "--bench-projection") == 0) {
+            bench_projection = true;
+        } else if (std::strcmp(argv[i], "--bench-software") == 0) {
+            bench_software = true;
+        } else if (std::strcmp(argv[i], "--color-space") == 0 && has_value && std::strcmp(argv[i + 1], "bt601") == 0) {
+            color_space = YuvColorSpace::BT601;
+            i++;
+        } else if (std::strcmp(argv[i], "--color-space") == 0 && has_value && std::strcmp(argv[i + 1], "bt709") == 0) {
+            color_space = YuvColorSpace::BT709;
+            i++;
+        } else if (std::strcmp(argv[i], "--demosaic") == 0 && has_value && std::strcmp(argv[i + 1], "bilinear") == 0) {
+            demosaic_method = DemosaicMethod::Bilinear;
+            i++;
+        } else if (std::strcmp(argv[i], "--demosaic") == 0 && has_value && std::strcmp(argv[i + 1], "malvar") == 0) {
+            demosaic_method = DemosaicMethod::MalvarHeCutler;
+            i++;
+        } else if (std::strcmp(argv[i], "--distortion") == 0 && has_value && std::strcmp(argv[i + 1], "none") == 0) {
+            distortion_mode = DistortionMode::None;
+            distortion_set = true;
+            i++;
+        } else if (std::strcmp(argv[i], "--distortion") == 0 && has_value && std::strcmp(argv[i + 1], "undistort") == 0) {
+            distortion_mode = DistortionMode::UndistortImage;
+            distortion_set = true;
+            i++;
+        } else if (std::strcmp(argv[i], "--distortion") == 0 && has_value && std::strcmp(argv[i + 1], "geometry") == 0) {
+            distortion_mode = DistortionMode::DistortGeometry;
+            distortion_set = true;
+            i++;
+        } else if (std::strcmp(argv[i], "--window-level") == 0 && has_value && std::sscanf(argv[i + 1], "%f,%f", &window, &level) == 2) {
+            i++;
+        } else if (std::strcmp(argv[i], "--reversed-z") == 0) {
+            depth_mode = DepthMode::ReversedZ;
+        } else if (std::strcmp(argv[i], "--no-upload-thread") == 0) {
+            upload_thread = false;
+        } else if (std::strcmp(argv[i], "--no-shader-cache") == 0) {
+            shader_cache = false;
+        } else if (std::strcmp(argv[i], "--no-vsync") == 0) {
+            vsync = false;
+        } else if (std::strcmp(argv[i], "--backend") == 0 && has_value) {
+            backend = argv[++i];
+        } else if (std::strcmp(argv[i], "--frames") == 0 && has_value) {
+            max_frames = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "--pose-cache") == 0 && has_value) {
+            pose_cache_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--record") == 0 && has_value) {
+            record_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--source") == 0 && has_value) {
+            source_spec = argv[++i];
+        } else if (std::strcmp(argv[i], "--calibration") == 0 && has_value) {
+            calibration_file = argv[++i];
+        } else if (std::strcmp(argv[i], "--poses") == 0 && has_value) {
+            pose_file = argv[++i];
+        } else if (std::strcmp(argv[i], "--pose-rate") == 0 && has_value && (pose_rate = std::atof(argv[i + 1])) > 0) {
+            i++;
+        } else if (std::strcmp(argv[i], "--no-pose-prediction") == 0) {
+            pose_prediction = false;
+        } else if (std::strcmp(argv[i], "--pose") == 0 && has_value && std::sscanf(argv[i + 1], "%lf,%lf,%lf,%lf,%lf,%lf",
+                &board_rvec[0], &board_rvec[1], &board_rvec[2], &board_tvec[0], &board_tvec[1], &board_tvec[2]) == 6) {
+            i++;
+        } else if (std::strcmp(argv[i], "--queue") == 0 && has_value && std::strcmp(argv[i + 1], "latest") == 0) {
+            queue_policy = QueuePolicy::Latest;
+            i++;
+        } else if (std::strcmp(argv[i], "--queue") == 0 && has_value && std::strcmp(argv[i + 1], "fifo") == 0) {
+            queue_policy = QueuePolicy::Fifo;
+            i++;
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--backend glfw|egl|osmesa] [--frames N] [--no-vsync] [--record DIR] "
+                "[--source left09|synthetic:WxH[:FORMAT]|files:DIR[:WxH[:FORMAT]]|shm:NAME] [--queue latest|fifo] [--no-upload-thread] "
+                "[--calibration FILE] [--distortion none|undistort|geometry] [--poses FILE] [--pose-cache DIR] [--pose-rate HZ] [--no-pose-prediction] [--pose RX,RY,RZ,TX,TY,TZ] "
+                "[--color-space bt601|bt709] [--demosaic bilinear|malvar] [--window-level WINDOW,LEVEL] [--reversed-z] "
+                "[--bench-distortion] [--bench-instances] [--bench-upload] [--bench-projection] [--bench-software] [--no-shader-cache]\n";
+            return -1;
+        }
+    }
+
+    // headless backends have no window to close
+    if (backend != "glfw" && max_frames < 0) {
+        max_frames = 300;
+    }
+
     // From OpenCV camera calibration for opencv/samples/data/left*.jpg
 
     // These units are in meters
@@ -37,233 +552,302 @@ int main(void)
     constexpr float board_height = 5 * square_size;
     constexpr float board_depth = 0.07;
 
-    // NOTE: We assume undistortion is already applied to the image eg. cv::undistort
-    // Hence we don't use any distortion value in this example.
-    constexpr float fx = 5.3646257838368388e+02;
-    constexpr float fy = 5.3641495077527384e+02;
-    constexpr float cx = 3.4236864003069093e+02;
-    constexpr float cy = 2.3554895272852343e+02;
+    // range of camera z that is drawn
+    constexpr float near_plane = 0.01;
+    constexpr float far_plane = 10;
 
-    // NOTE: glm is column first then row
-    glm::mat4 camera_matrix(1.0);
+    // camera_matrix of the 640x480 calibration, row-major like OpenCV writes it
+    const double camera_matrix[9] = {
+        5.3646257838368388e+02, 0, 3.4236864003069093e+02,
+        0, 5.3641495077527384e+02, 2.3554895272852343e+02,
+        0, 0, 1};
 
-    // typical 3x3 camera matrix but as 4x4 instead
-    camera_matrix[0][0] = fx;
-    camera_matrix[1][1] = fy;
-    camera_matrix[2][0] = cx;
-    camera_matrix[2][1] = cy;
+    // NOTE: left09 already has undistortion applied eg. cv::undistort, hence the coefficients are zero.
+    // --calibration replaces this with a file written by the OpenCV calibration sample.
+    CameraModel camera = CameraModel::fromMatrix(640, 480, camera_matrix, DistortionCoeffs());
 
-    // extrinsics for opencv/samples/data/left09.jpg
-    glm::mat4 board_pose(1.0);
+    // rvec and tvec to model matrix, see src/rodrigues.hpp
+    const glm::mat4 board_pose = poseFromRodrigues(board_rvec, board_tvec);
 
-    // rotation
-    board_pose[0][0] = 0.9032419130191708;
-    board_pose[0][1] = 0.08505603062460287;
-    board_pose[0][2] = 0.4206180193713239;
+    const char *home = std::getenv("HOME");
 
-    board_pose[1][0] = -0.1694525821415028;
-    board_pose[1][1] = 0.9712014559118498;
-    board_pose[1][2] = 0.1674919533597971;
-
-    board_pose[2][0] = -0.3942586320818429;
-    board_pose[2][1] = -0.2225605618457364;
-    board_pose[2][2] = 0.8916428249808688;
-
-    // translation
-    board_pose[3][0] = -5.3109423342047581e-02;
-    board_pose[3][1] = -6.4807198552484332e-02;
-    board_pose[3][2] = 2.2278644271121698e-01;
+    if (shader_cache && home) {
+        setProgramBinaryCache(std::string(home) + "/.cache/OpenCV_camera_in_OpenGL");
+    }
 
-    glfwSetErrorCallback(error_callback);
+    if (!pose_cache_dir.empty()) {
+        setPoseCache(pose_cache_dir);
+    }
 
-    if (!glfwInit()) {
-        std::cerr << "glfwInit failed\n";
+    // --poses plays back pose_rate poses a second, looping, instead of board_pose
+    std::vector<glm::mat4> poses;
+    std::unique_ptr<FrameSource> source;
+    std::unique_ptr<RenderContext> context;
+
+    try {
+        if (!calibration_file.empty()) {
+            camera = loadCalibration(calibration_file);
+
+            // a calibrated camera comes with raw frames, distort the overlay to match them
+            // unless --distortion says otherwise
+            if (!distortion_set && !camera.distortion().isZero()) {
+                distortion_mode = DistortionMode::DistortGeometry;
+            }
+        }
+
+        if (!pose_file.empty()) {
+            poses = loadPoses(pose_file);
+
+            if (poses.empty()) {
+                throw std::runtime_error(pose_file + " has no poses");
+            }
+        }
+
+        source = createFrameSource(source_spec);
+        context = createRenderContext(backend, source->width(), source->height(), "OpenCV camera in OpenGL example", vsync);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << "\n";
         return -1;
     }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    std::cout << "Render backend: " << context->name() << "\n";
+    std::cout << "Frame source: " << source_spec << " " << source->width() << "x" << source->height() << " "
+        << pixelFormatName(source->format()) << "\n";
 
-    GLFWwindow *window = glfwCreateWindow(left09_width(), left09_height(), "OpenCV camera in OpenGL example", NULL, NULL);
+    // cuboid model
+    Mesh cuboid = cuboidMesh(board_width, board_height, board_depth);
 
-    if (!window) {
-        std::cerr << "glfwCreateWindow failed\n";
-        glfwTerminate();
-        return -1;
+    if (bench_distortion || bench_instances || bench_upload || bench_projection || bench_software) {
+        if (bench_distortion) {
+            benchmarkDistortion(cuboid, board_pose, camera);
+        }
+
+        if (bench_instances) {
+            benchmarkInstances(cuboid, board_pose, camera);
+        }
+
+        if (bench_upload) {
+            benchmarkUpload(*context, cuboid, board_pose, camera);
+            benchmarkUploadFormats();
+        }
+
+        if (bench_projection) {
+            benchmarkProjection(board_pose, camera);
+        }
+
+        if (bench_software) {
+            benchmarkSoftware(cuboid, board_pose, camera);
+        }
+
+        return 0;
     }
 
-    glfwMakeContextCurrent(window);
+    OverlayRenderer renderer(source->width(), source->height(), cuboid);
+    renderer.setCamera(camera);
+    renderer.setDistortionMode(distortion_mode);
 
-    GLenum err = glewInit();
+    if (depth_mode == DepthMode::ReversedZ && !OverlayRenderer::isReversedZSupported()) {
+        std::cerr << "ARB_clip_control not supported, using standard depth\n";
+        depth_mode = DepthMode::Standard;
+    }
 
-    if (GLEW_OK != err) {
-        std::cerr << "glewInit error: " << glewGetErrorString(err) << "\n";
-        return -1;
+    renderer.setDepthRange(near_plane, far_plane, depth_mode);
+    renderer.setColorSpace(color_space);
+    renderer.setDemosaicMethod(demosaic_method);
+    renderer.setWindowLevel(window, level);
+
+    // Streaming texture for the background image. The source runs on its own thread, and frames
+    // are uploaded on another one with a shared GL context, so the render loop only picks up the
+    // newest finished texture (or the next one, with --queue fifo). Without a shared context the
+    // render loop uploads them itself. The default left09 source stands in for a live camera feed.
+    // Sources that generate their frames write them straight into the mapped upload buffers.
+    CaptureThread capture(std::move(source), queue_policy, 4, true);
+    std::unique_ptr<UploadWorker> upload_worker;
+    std::unique_ptr<FrameUploader> uploader;
+    FrameStats stats;
+    bool first_frame = true;
+
+    if (upload_thread) {
+        try {
+            upload_worker.reset(new UploadWorker(*context, capture));
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << ", uploading on the render thread\n";
+        }
+    }
+
+    if (upload_worker) {
+        std::cout << "Frame upload: worker thread\n";
+    } else {
+        uploader = createFrameUploader(capture.width(), capture.height(), capture.format());
+        std::cout << "Frame upload: " << uploader->name() << "\n";
     }
 
-    std::cout << "Using GLEW " <<glewGetString(GLEW_VERSION) << "\n";
+    // Recording of the composited frames. Frames come back through a PBO ring a few frames
+    // late and are written out as PPM on a separate thread.
+    std::unique_ptr<FrameReadback> readback;
+    BlockingQueue<Image> recorded(8);
+    std::thread recorder;
+
+    if (!record_dir.empty()) {
+        recorder = std::thread([&recorded, &record_dir]() {
+            Image image;
+
+            for (int i = 0; recorded.pop(image); i++) {
+                char name[32];
+                std::snprintf(name, sizeof(name), "/%06d.ppm", i);
+
+                try {
+                    savePPM(record_dir + name, image, true);
+                } catch (const std::runtime_error &e) {
+                    std::cerr << e.what() << ", recording stopped\n";
+                    recorded.close();
+                }
+            }
+        });
+    }
 
-    glfwSetKeyCallback(window, key_callback);
-    glfwMakeContextCurrent(window);
-    glfwSwapInterval(1);
+    auto record = [&recorded](uint64_t id, const unsigned char *rgba, int width, int height) {
+        Image image;
+        image.width = width;
+        image.height = height;
+        image.channels = 4;
+        image.data.assign(rgba, rgba + static_cast<size_t>(width) * height * 4);
+        recorded.push(std::move(image));
+    };
+
+    // The pose log stands in for a live tracker: pose i arrives at playback start + i / pose_rate
+    // and only poses that have arrived are in the buffer. Each frame samples it at the predicted
+    // display time, between poses interpolated and past the newest one extrapolated.
+    PoseBuffer pose_buffer;
+    DisplayTimer display_timer;
+    const int64_t playback_start = steadyNanoseconds();
+    size_t next_pose = 0;
+
+    bool lent = false;
+
+    for (long frame = 0; !context->shouldClose() && frame != max_frames; frame++) {
+        int width, height;
+        const FrameTextures *background;
 
-    GLuint vertex_array;
-    GLuint vertex_buffer;
-    GLuint texture_buffer;
-    GLuint cuboid_vertex_buffer;
-    GLuint cuboid_color_buffer;
-    GLuint cuboid_index_buffer;
+        if (upload_worker) {
+            background = &upload_worker->textures();
 
-    GL_CHECK(glGenVertexArrays(1, &vertex_array));
-    GL_CHECK(glBindVertexArray(vertex_array));
+            if (upload_worker->finished()) {
+                std::cerr << "Frame source " << source_spec << " ended\n";
+                break;
+            }
+        } else {
+            Frame camera_frame;
 
-    // vertices and texcoord for the texture quad
-    float w = left09_width();
-    float h = left09_height();
+            // the capture fills the next upload buffer while this frame renders
+            if (capture.fillsInPlace() && !lent) {
+                lent = capture.provide(uploader->acquire());
+            }
 
-    const float vertices[] = {
-        0.0, 0.0,   0.0, 0.0,
-        0.0, h,     0.0, 1.0,
-        w, 0.0,     1.0, 0.0,
-        w, h,       1.0, 1.0};
+            if (capture.next(camera_frame)) {
+                stats.beginUpload();
 
-    GL_CHECK(glGenBuffers(1, &vertex_buffer));
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer));
-    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW));
-    GL_CHECK(glEnableVertexAttribArray(0));
-    GL_CHECK(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr));
+                if (capture.fillsInPlace()) {
+                    uploader->submit();
+                    lent = false;
+                } else {
+                    uploader->upload(camera_frame.data, camera_frame.stride);
+                }
 
-    // cuboid model
-    w = board_width;
-    h = board_height;
-
-    const float cuboid_vertices[] = {
-        0, 0, 0,
-        w, 0, 0,
-        w, h, 0,
-        0, h, 0,
-        0, 0, -board_depth,
-        w, 0, -board_depth,
-        w, h, -board_depth,
-        0, h, -board_depth};
-
-    const float cuboid_color[] = {
-        1.0, 0.0, 0.0, 0.5,
-        1.0, 0.0, 0.0, 0.5,
-        1.0, 0.0, 0.0, 0.5,
-        1.0, 0.0, 0.0, 0.5,
-        0.0, 1.0, 0.0, 0.5,
-        0.0, 1.0, 0.0, 0.5,
-        0.0, 1.0, 0.0, 0.5,
-        0.0, 1.0, 0.0, 0.5};
-
-    const uint32_t cuboid_triangle_indices[] = {
-        0, 1, 2,
-        0, 2, 3,
-        0, 1, 4,
-        1, 4, 5,
-        1, 2, 6,
-        6, 5, 1,
-        0, 4, 7,
-        0, 3, 7,
-        2, 3, 7,
-        2, 6, 7};
-
-    GL_CHECK(glGenBuffers(1, &cuboid_vertex_buffer));
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, cuboid_vertex_buffer));
-    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(cuboid_vertices), cuboid_vertices, GL_STATIC_DRAW));
-
-    GL_CHECK(glGenBuffers(1, &cuboid_color_buffer));
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, cuboid_color_buffer));
-    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(cuboid_color), cuboid_color, GL_STATIC_DRAW));
-
-    GL_CHECK(glGenBuffers(1, &cuboid_index_buffer));
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cuboid_index_buffer));
-    GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cuboid_triangle_indices), cuboid_triangle_indices, GL_STATIC_DRAW));
-
-    // load the texture
-    GL_CHECK(glGenTextures(1, &texture_buffer));
-    GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture_buffer));
-    GL_CHECK(glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        GL_RED, // grayscale image loaded into red channel
-        left09_width(),
-        left09_height(),
-        0,
-        GL_RED,
-        GL_UNSIGNED_BYTE,
-        left09_data()));
-
-    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-
-    GLuint vertex_shader = loadShaders(VERTEX_SHADER, FRAGMENT_SHADER);
-    GLuint texture_shader = loadShaders(TEXTURE_VERTEX_SHADER, TEXTURE_FRAGMENT_SHADER);
-
-    GL_CHECK(glEnableVertexAttribArray(0));
-    GL_CHECK(glEnableVertexAttribArray(1));
-
-    while (!glfwWindowShouldClose(window)) {
-        int width, height;
+                stats.endUpload();
+
+                capture.release(camera_frame);
+            } else if (capture.finished()) {
+                std::cerr << "Frame source " << source_spec << " ended\n";
+                break;
+            }
+
+            background = &uploader->textures();
+        }
 
-        glfwGetFramebufferSize(window, &width, &height);
+        context->framebufferSize(width, height);
+        context->beginFrame();
 
-        GL_CHECK(glViewport(0, 0, width, height));
-        GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
+        int64_t display_ns = display_timer.beginFrame();
+        int64_t motion_ns = 0;
+        int64_t pose_ns = 0;
+        glm::mat4 pose = board_pose;
 
-        // OpenGL convention, -z is into the screen
-        constexpr float zNear = 0.0;
-        constexpr float zFar = -10;
+        if (!poses.empty()) {
+            int64_t now = steadyNanoseconds();
+            int64_t arrival_ns;
 
-        // Flip the y-axis so (0,0) is at the top left corner of the viewport
-        glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, zNear, zFar);
+            while ((arrival_ns = playback_start + static_cast<int64_t>(next_pose * 1e9 / pose_rate)) <= now) {
+                pose_buffer.push(arrival_ns, poses[next_pose % poses.size()]);
+                next_pose++;
+            }
 
-        // Draw the texture
-        GL_CHECK(glUseProgram(texture_shader));
-        GL_CHECK(glUniformMatrix4fv(glGetUniformLocation(texture_shader, "mvp"), 1, GL_FALSE, glm::value_ptr(projection)));
+            pose_ns = pose_prediction ? display_ns : now;
+            pose_buffer.sample(pose_ns, pose, &motion_ns);
+        }
 
-        GL_CHECK(glActiveTexture(GL_TEXTURE0));
-        GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture_buffer));
-        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer));
-        GL_CHECK(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr));
-        GL_CHECK(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
-        GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+        renderer.draw(*background, pose, width, height);
 
-        // Draw the cuboid
-        GL_CHECK(glEnable(GL_DEPTH_TEST));
-        GL_CHECK(glClear(GL_DEPTH_BUFFER_BIT));
+        if (recorder.joinable()) {
+            // the window can be resized
+            if (!readback || readback->width() != width || readback->height() != height) {
+                if (readback) {
+                    readback->flush();
+                }
 
-        GL_CHECK(glEnable(GL_BLEND));
-        GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+                readback.reset(new FrameReadback(width, height, record));
+            }
 
-        GL_CHECK(glUseProgram(vertex_shader));
-        GL_CHECK(glUniformMatrix4fv(glGetUniformLocation(vertex_shader, "projection"), 1, GL_FALSE, glm::value_ptr(projection)));
-        GL_CHECK(glUniformMatrix4fv(glGetUniformLocation(vertex_shader, "camera"), 1, GL_FALSE, glm::value_ptr(camera_matrix)));
-        GL_CHECK(glUniformMatrix4fv(glGetUniformLocation(vertex_shader, "model"), 1, GL_FALSE, glm::value_ptr(board_pose)));
+            readback->readback(frame);
+        }
 
-        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, cuboid_vertex_buffer));
-        GL_CHECK(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr));
+        checkOpenGLFrame();
 
-        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, cuboid_color_buffer));
-        GL_CHECK(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, nullptr));
+        display_timer.endFrame(motion_ns, pose_ns);
+        context->endFrame();
+        display_timer.poll();
 
-        GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cuboid_index_buffer));
-        GL_CHECK(glDrawElements(GL_TRIANGLES, sizeof(cuboid_triangle_indices)/sizeof(cuboid_triangle_indices[0]),  GL_UNSIGNED_INT , 0));
+        if (first_frame) {
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startup).count();
+            std::cout << "Start to first frame: " << ms << " ms\n";
+            first_frame = false;
+        }
 
-        GL_CHECK(glDisable(GL_DEPTH_TEST));
-        GL_CHECK(glDisable(GL_BLEND));
+        if (stats.frame()) {
+            double upload_ms = upload_worker ? upload_worker->uploadMs() : stats.uploadMs();
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+            std::cout << "fps: " << stats.fps() << ", upload: " << upload_ms << " ms, "
+                "dropped: " << capture.dropped() << ", skipped: " << capture.skipped() << "\n";
+
+            double latency_ms, motion_to_photon_ms, residual_ms;
+
+            if (display_timer.report(latency_ms, motion_to_photon_ms, residual_ms)) {
+                std::cout << "latency: frame " << latency_ms << " ms";
+
+                if (!poses.empty()) {
+                    std::cout << ", motion to photon " << motion_to_photon_ms << " ms, after "
+                        << (pose_prediction ? "prediction " : "sampling ") << residual_ms << " ms";
+                }
+
+                std::cout << "\n";
+            }
+        }
     }
 
-    glfwDestroyWindow(window);
+    // a buffer lent to the capture is written until it stops, the uploader unmaps it. The upload
+    // worker stops the capture itself.
+    if (!upload_worker) {
+        capture.stop();
+    }
+
+    if (recorder.joinable()) {
+        if (readback) {
+            readback->flush();
+        }
 
-    glfwTerminate();
+        recorded.close();
+        recorder.join();
+    }
 
     return 0;
 }
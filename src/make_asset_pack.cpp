@@ -0,0 +1,24 @@
+#include <iostream>
+#include <stdexcept>
+
+#include "asset_pack.hpp"
+#include "image_io.hpp"
+
+// Converts an 8-bit binary PGM into an asset pack
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " <input.pgm> <output.pack>\n";
+        return -1;
+    }
+
+    try {
+        Image image = loadPGM(argv[1]);
+        writeAssetPack(argv[2], image.width, image.height, AssetPack::GRAY8, image.width, image.data.data());
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << "\n";
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <cstddef>
+
+#include "mesh.hpp"
+
+Mesh cuboidMesh(float w, float h, float d)
+{
+    Mesh mesh;
+
+    mesh.vertices = {
+        0, 0, 0,
+        w, 0, 0,
+        w, h, 0,
+        0, h, 0,
+        0, 0, -d,
+        w, 0, -d,
+        w, h, -d,
+        0, h, -d};
+
+    mesh.colors = {
+        1.0, 0.0, 0.0, 0.5,
+        1.0, 0.0, 0.0, 0.5,
+        1.0, 0.0, 0.0, 0.5,
+        1.0, 0.0, 0.0, 0.5,
+        0.0, 1.0, 0.0, 0.5,
+        0.0, 1.0, 0.0, 0.5,
+        0.0, 1.0, 0.0, 0.5,
+        0.0, 1.0, 0.0, 0.5};
+
+    mesh.indices = {
+        0, 1, 2,
+        0, 2, 3,
+        0, 1, 4,
+        1, 4, 5,
+        1, 2, 6,
+        6, 5, 1,
+        0, 4, 7,
+        0, 3, 7,
+        2, 3, 7,
+        2, 6, 7};
+
+    return mesh;
+}
+
+static uint32_t addMidpoint(Mesh &mesh, uint32_t a, uint32_t b)
+{
+    uint32_t index = mesh.vertices.size() / 3;
+
+    for (int i = 0; i < 3; i++) {
+        mesh.vertices.push_back(0.5f*(mesh.vertices[a*3 + i] + mesh.vertices[b*3 + i]));
+    }
+
+    for (int i = 0; i < 4; i++) {
+        mesh.colors.push_back(0.5f*(mesh.colors[a*4 + i] + mesh.colors[b*4 + i]));
+    }
+
+    return index;
+}
+
+Mesh subdivideMesh(const Mesh &mesh, int levels)
+{
+    Mesh ret = mesh;
+
+    for (int level = 0; level < levels; level++) {
+        std::vector<uint32_t> indices;
+        indices.reserve(ret.indices.size() * 4);
+
+        // NOTE: midpoints of shared edges are duplicated, they land on the exact same position
+        for (size_t i = 0; i + 2 < ret.indices.size(); i += 3) {
+            uint32_t a = ret.indices[i];
+            uint32_t b = ret.indices[i + 1];
+            uint32_t c = ret.indices[i + 2];
+
+            uint32_t ab = addMidpoint(ret, a, b);
+            uint32_t bc = addMidpoint(ret, b, c);
+            uint32_t ca = addMidpoint(ret, c, a);
+
+            const uint32_t tris[] = {
+                a, ab, ca,
+                ab, b, bc,
+                ca, bc, c,
+                ab, bc, ca};
+
+            indices.insert(indices.end(), tris, tris + 12);
+        }
+
+        ret.indices.swap(indices);
+    }
+
+    return ret;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Indexed triangle mesh with a color per vertex
+struct Mesh
+{
+    std::vector<float> vertices; // x, y, z
+    std::vector<float> colors; // r, g, b, a
+    std::vector<uint32_t> indices; // 3 per triangle
+};
+
+// Cuboid sitting on the board, one corner at the origin and extending along -z.
+// The front face (z = 0) is red and the back face green, both half transparent.
+Mesh cuboidMesh(float width, float height, float depth);
+
+// Split every triangle into 4 at the edge midpoints, repeated levels times.
+// Needed when vertices go through a non-linear projection so straight edges can bend.
+Mesh subdivideMesh(const Mesh &mesh, int levels);
@@ -0,0 +1,777 @@
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "opencv_storage.hpp"
+
+// Single pass over the text of a FileStorage file. p_ only moves forward, every parse function
+// leaves it after what it consumed, the YAML ones at the start of the next unconsumed line.
+class StorageParser
+{
+public:
+    StorageParser(const std::string &content, OpenCVStorage &storage) :
+        begin_(content.c_str()),
+        p_(content.c_str()),
+        end_(content.c_str() + content.size()),
+        storage_(storage)
+    {
+    }
+
+    void parse()
+    {
+        skipWhitespace();
+
+        if (startsWith("<?xml") || startsWith("<opencv_storage")) {
+            parseXml();
+        } else {
+            parseYaml();
+        }
+    }
+
+private:
+    [[noreturn]] void fail(const std::string &message) const
+    {
+        int line = 1;
+
+        for (const char *c = begin_; c < p_; c++) {
+            line += *c == '\n';
+        }
+
+        throw std::runtime_error(storage_.name_ + ":" + std::to_string(line) + " " + message);
+    }
+
+    bool startsWith(const char *str) const
+    {
+        size_t n = std::strlen(str);
+        return static_cast<size_t>(end_ - p_) >= n && std::memcmp(p_, str, n) == 0;
+    }
+
+    void skipWhitespace()
+    {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) {
+            p_++;
+        }
+    }
+
+    void skipSpaces()
+    {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t')) {
+            p_++;
+        }
+    }
+
+    // YAML writes inf and nan as .Inf and .Nan, strtod handles everything else. The content is
+    // a std::string, so strtod always stops at its terminating null.
+    bool parseNumber(double &value)
+    {
+        const char *s = p_;
+        bool negative = *s == '-';
+
+        if (*s == '-' || *s == '+') {
+            s++;
+        }
+
+        if (std::strncmp(s, ".Inf", 4) == 0 || std::strncmp(s, ".inf", 4) == 0) {
+            value = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+            p_ = s + 4;
+            return true;
+        }
+
+        if (std::strncmp(s, ".Nan", 4) == 0 || std::strncmp(s, ".nan", 4) == 0) {
+            value = std::numeric_limits<double>::quiet_NaN();
+            p_ = s + 4;
+            return true;
+        }
+
+        char *number_end;
+        value = std::strtod(p_, &number_end);
+
+        if (number_end == p_) {
+            return false;
+        }
+
+        p_ = number_end;
+        return true;
+    }
+
+    // A token that isn't a number, up to the next separator
+    void skipToken()
+    {
+        while (p_ < end_ && !std::strchr(" \t\r\n,[]{}<", *p_)) {
+            p_++;
+        }
+    }
+
+    // --- YAML ---
+
+    void skipLine()
+    {
+        const char *newline = static_cast<const char*>(std::memchr(p_, '\n', end_ - p_));
+        p_ = newline ? newline + 1 : end_;
+    }
+
+    bool atLineEnd()
+    {
+        skipSpaces();
+        return p_ == end_ || *p_ == '\n' || *p_ == '\r' || *p_ == '#';
+    }
+
+    // Moves to the start of the next line with content and gives its indent, false at the end
+    bool nextContentLine(int &indent)
+    {
+        while (p_ < end_) {
+            const char *c = p_;
+
+            while (c < end_ && *c == ' ') {
+                c++;
+            }
+
+            if (c == end_) {
+                p_ = end_;
+                return false;
+            }
+
+            if (*c == '\n' || *c == '\r' || *c == '#') {
+                skipLine();
+                continue;
+            }
+
+            indent = c - p_;
+            return true;
+        }
+
+        return false;
+    }
+
+    // Skips every following line indented more than indent
+    void skipBlock(int indent)
+    {
+        int child_indent;
+
+        while (nextContentLine(child_indent) && child_indent > indent) {
+            skipLine();
+        }
+    }
+
+    std::string readKey()
+    {
+        const char *start = p_;
+
+        while (p_ < end_ && *p_ != '\n' && !(*p_ == ':' && (p_ + 1 == end_ || std::strchr(" \t\r\n", p_[1])))) {
+            p_++;
+        }
+
+        if (p_ == end_ || *p_ != ':') {
+            fail("expected key: value");
+        }
+
+        std::string key(start, p_ - start);
+        p_++;
+
+        return key;
+    }
+
+    void parseYaml()
+    {
+        int indent;
+
+        while (nextContentLine(indent)) {
+            p_ += indent;
+
+            // %YAML:1.0 directive and --- document markers
+            if (*p_ == '%' || startsWith("---") || startsWith("...")) {
+                skipLine();
+                continue;
+            }
+
+            std::string key = readKey();
+            StorageNode node;
+
+            if (parseYamlValue(node, indent)) {
+                storage_.nodes_[key] = std::move(node);
+            }
+        }
+    }
+
+    // Value after "key:" or "-" at indent, false if it isn't something StorageNode holds
+    bool parseYamlValue(StorageNode &node, int indent)
+    {
+        skipSpaces();
+
+        if (startsWith("!!")) {
+            const char *tag = p_;
+            skipToken();
+            bool matrix = std::string(tag, p_ - tag) == "!!opencv-matrix";
+            skipLine();
+
+            if (matrix) {
+                parseYamlMatrix(node, indent);
+                return true;
+            }
+
+            skipBlock(indent);
+            return false;
+        }
+
+        if (p_ < end_ && (*p_ == '[' || *p_ == '{')) {
+            bool numeric = *p_ == '[' && parseFlowSequence(node);
+            skipLine();
+            return numeric;
+        }
+
+        if (atLineEnd()) {
+            skipLine();
+            return parseYamlBlock(node, indent);
+        }
+
+        parseScalar(node);
+        return true;
+    }
+
+    // [ ... ] or { ... } over any number of lines, false if anything in it isn't a number
+    bool parseFlowSequence(StorageNode &node)
+    {
+        node.type = StorageNode::Sequence;
+
+        bool numeric = *p_ == '[';
+        int depth = 0;
+
+        while (p_ < end_) {
+            skipWhitespace();
+
+            if (p_ == end_) {
+                break;
+            }
+
+            char c = *p_;
+
+            if (c == '[' || c == '{') {
+                // nested sequences are one item each
+                node.items += depth == 1;
+                depth++;
+                p_++;
+            } else if (c == ']' || c == '}') {
+                depth--;
+                p_++;
+
+                if (depth == 0) {
+                    return numeric;
+                }
+            } else if (c == ',') {
+                p_++;
+            } else {
+                double value;
+
+                if (parseNumber(value)) {
+                    node.values.push_back(value);
+                    node.items += depth == 1;
+                } else {
+                    numeric = false;
+                    p_++;
+                    skipToken();
+                }
+            }
+        }
+
+        fail("unterminated sequence");
+    }
+
+    // rows, cols, dt and data indented under the !!opencv-matrix tag
+    void parseYamlMatrix(StorageNode &node, int indent)
+    {
+        node.type = StorageNode::Matrix;
+
+        int channels = 1;
+        bool has_data = false;
+        int child_indent;
+
+        while (nextContentLine(child_indent) && child_indent > indent) {
+            p_ += child_indent;
+            std::string key = readKey();
+            skipSpaces();
+
+            if (key == "rows") {
+                node.rows = std::strtol(p_, nullptr, 10);
+            } else if (key == "cols") {
+                node.cols = std::strtol(p_, nullptr, 10);
+            } else if (key == "dt") {
+                channels = dataChannels();
+            } else if (key == "data") {
+                if (p_ == end_ || *p_ != '[') {
+                    fail("expected [ after data:");
+                }
+
+                node.values.reserve(static_cast<size_t>(node.rows) * node.cols * channels);
+
+                StorageNode data;
+                data.values.swap(node.values);
+
+                if (!parseFlowSequence(data)) {
+                    fail("matrix data that isn't numbers");
+                }
+
+                node.values.swap(data.values);
+                has_data = true;
+            }
+
+            skipLine();
+        }
+
+        finishMatrix(node, channels, has_data);
+    }
+
+    // Block sequence of "- item" lines, or a nested map that is skipped
+    bool parseYamlBlock(StorageNode &node, int indent)
+    {
+        int item_indent;
+
+        if (!nextContentLine(item_indent) || item_indent <= indent) {
+            return false;
+        }
+
+        if (p_[item_indent] != '-') {
+            skipBlock(indent);
+            return false;
+        }
+
+        node.type = StorageNode::Sequence;
+        bool numeric = true;
+        int line_indent;
+
+        while (nextContentLine(line_indent) && line_indent == item_indent && p_[line_indent] == '-') {
+            p_ += line_indent + 1;
+
+            StorageNode item;
+
+            if (parseYamlValue(item, item_indent) && item.type != StorageNode::String) {
+                node.values.insert(node.values.end(), item.values.begin(), item.values.end());
+                node.items++;
+            } else {
+                numeric = false;
+            }
+        }
+
+        return numeric;
+    }
+
+    // Rest of the line, a quoted string, a number or else a plain string
+    void parseScalar(StorageNode &node)
+    {
+        const char *line_end = p_;
+
+        while (line_end < end_ && *line_end != '\n' && *line_end != '\r') {
+            line_end++;
+        }
+
+        if (*p_ == '"' || *p_ == '\'') {
+            const char *quote = static_cast<const char*>(std::memchr(p_ + 1, *p_, line_end - p_ - 1));
+
+            node.type = StorageNode::String;
+            node.text.assign(p_ + 1, quote ? quote : line_end);
+        } else {
+            const char *text_end = line_end;
+
+            while (text_end > p_ && (text_end[-1] == ' ' || text_end[-1] == '\t')) {
+                text_end--;
+            }
+
+            double value;
+            const char *start = p_;
+
+            if (parseNumber(value) && p_ == text_end) {
+                node.type = StorageNode::Number;
+                node.values.assign(1, value);
+            } else {
+                node.type = StorageNode::String;
+                node.text.assign(start, text_end);
+            }
+        }
+
+        p_ = line_end;
+        skipLine();
+    }
+
+    // --- XML ---
+
+    void skipXmlSpaceAndComments()
+    {
+        for (;;) {
+            skipWhitespace();
+
+            if (!startsWith("<!--")) {
+                return;
+            }
+
+            const char *comment_end = std::strstr(p_, "-->");
+
+            if (!comment_end) {
+                fail("unterminated comment");
+            }
+
+            p_ = comment_end + 3;
+        }
+    }
+
+    // <name attr="value" ...> with p_ at the '<', false for a self closing <name/>
+    bool readOpenTag(std::string &name, std::string &type_id)
+    {
+        p_++;
+        const char *start = p_;
+
+        while (p_ < end_ && !std::strchr(" \t\r\n/>", *p_)) {
+            p_++;
+        }
+
+        name.assign(start, p_);
+        type_id.clear();
+
+        for (;;) {
+            skipWhitespace();
+
+            if (p_ == end_) {
+                fail("unterminated tag <" + name);
+            }
+
+            if (*p_ == '>') {
+                p_++;
+                return true;
+            }
+
+            if (startsWith("/>")) {
+                p_ += 2;
+                return false;
+            }
+
+            const char *attr = p_;
+
+            while (p_ < end_ && *p_ != '=' && *p_ != '>') {
+                p_++;
+            }
+
+            std::string attr_name(attr, p_);
+            p_++;
+            skipWhitespace();
+
+            char quote = *p_++;
+            const char *value = p_;
+            const char *value_end = static_cast<const char*>(std::memchr(p_, quote, end_ - p_));
+
+            if (!value_end) {
+                fail("unterminated attribute in <" + name);
+            }
+
+            if (attr_name == "type_id") {
+                type_id.assign(value, value_end);
+            }
+
+            p_ = value_end + 1;
+        }
+    }
+
+    void expectCloseTag(const std::string &name)
+    {
+        skipXmlSpaceAndComments();
+
+        std::string tag = "</" + name;
+
+        if (!startsWith(tag.c_str())) {
+            fail("expected " + tag + ">");
+        }
+
+        p_ += tag.size();
+        skipWhitespace();
+
+        if (p_ == end_ || *p_ != '>') {
+            fail("expected " + tag + ">");
+        }
+
+        p_++;
+    }
+
+    void parseXml()
+    {
+        if (startsWith("<?xml")) {
+            const char *declaration_end = std::strstr(p_, "?>");
+
+            if (!declaration_end) {
+                fail("unterminated <?xml");
+            }
+
+            p_ = declaration_end + 2;
+        }
+
+        skipXmlSpaceAndComments();
+
+        std::string root, type_id;
+
+        if (p_ == end_ || *p_ != '<' || !readOpenTag(root, type_id) || root != "opencv_storage") {
+            fail("expected <opencv_storage>");
+        }
+
+        for (;;) {
+            skipXmlSpaceAndComments();
+
+            if (startsWith("</")) {
+                break;
+            }
+
+            if (p_ == end_ || *p_ != '<') {
+                fail("expected an element");
+            }
+
+            std::string name;
+            StorageNode node;
+
+            if (readOpenTag(name, type_id) && parseXmlContent(node, name, type_id)) {
+                storage_.nodes_[name] = std::move(node);
+            }
+        }
+
+        expectCloseTag(root);
+    }
+
+    // Everything up to and including </name>, false if it isn't something StorageNode holds
+    bool parseXmlContent(StorageNode &node, const std::string &name, const std::string &type_id)
+    {
+        if (type_id == "opencv-matrix") {
+            parseXmlMatrix(node, name);
+            return true;
+        }
+
+        skipXmlSpaceAndComments();
+
+        // child elements, <_> items of a sequence or a nested map
+        if (startsWith("<") && !startsWith("</")) {
+            node.type = StorageNode::Sequence;
+            bool numeric = true;
+
+            while (!startsWith("</")) {
+                if (p_ == end_ || *p_ != '<') {
+                    fail("expected an element in <" + name + ">");
+                }
+
+                std::string child, child_type_id;
+                StorageNode item;
+
+                if (readOpenTag(child, child_type_id) && parseXmlContent(item, child, child_type_id) &&
+                    child == "_" && item.type != StorageNode::String) {
+                    node.values.insert(node.values.end(), item.values.begin(), item.values.end());
+                    node.items++;
+                } else {
+                    numeric = false;
+                }
+
+                skipXmlSpaceAndComments();
+            }
+
+            expectCloseTag(name);
+            return numeric;
+        }
+
+        parseXmlText(node);
+        expectCloseTag(name);
+        return true;
+    }
+
+    // One number, several numbers separated by whitespace, or a string
+    void parseXmlText(StorageNode &node)
+    {
+        const char *start = p_;
+        const char *text_end = static_cast<const char*>(std::memchr(p_, '<', end_ - p_));
+
+        if (!text_end) {
+            fail("unterminated element");
+        }
+
+        bool numeric = true;
+        double value;
+
+        for (;;) {
+            skipWhitespace();
+
+            if (p_ >= text_end) {
+                break;
+            }
+
+            if (!parseNumber(value) || p_ > text_end) {
+                numeric = false;
+                break;
+            }
+
+            node.values.push_back(value);
+        }
+
+        if (numeric && node.values.size() == 1) {
+            node.type = StorageNode::Number;
+        } else if (numeric && !node.values.empty()) {
+            node.type = StorageNode::Sequence;
+            node.items = node.values.size();
+        } else {
+            // strings are written quoted
+            while (start < text_end && std::strchr(" \t\r\n\"", *start)) {
+                start++;
+            }
+
+            const char *last = text_end;
+
+            while (last > start && std::strchr(" \t\r\n\"", last[-1])) {
+                last--;
+            }
+
+            node.type = StorageNode::String;
+            node.text.assign(start, last);
+            node.values.clear();
+        }
+
+        p_ = text_end;
+    }
+
+    void parseXmlMatrix(StorageNode &node, const std::string &name)
+    {
+        node.type = StorageNode::Matrix;
+
+        int channels = 1;
+        bool has_data = false;
+
+        for (;;) {
+            skipXmlSpaceAndComments();
+
+            if (startsWith("</")) {
+                break;
+            }
+
+            std::string child, type_id;
+
+            if (p_ == end_ || *p_ != '<' || !readOpenTag(child, type_id)) {
+                fail("expected rows, cols, dt and data in <" + name + ">");
+            }
+
+            skipWhitespace();
+
+            if (child == "rows") {
+                node.rows = std::strtol(p_, nullptr, 10);
+            } else if (child == "cols") {
+                node.cols = std::strtol(p_, nullptr, 10);
+            } else if (child == "dt") {
+                channels = dataChannels();
+            } else if (child == "data") {
+                node.values.reserve(static_cast<size_t>(node.rows) * node.cols * channels);
+
+                double value;
+
+                for (;;) {
+                    skipWhitespace();
+
+                    if (p_ == end_ || *p_ == '<') {
+                        break;
+                    }
+
+                    if (!parseNumber(value)) {
+                        fail("matrix data that isn't numbers");
+                    }
+
+                    node.values.push_back(value);
+                }
+
+                has_data = true;
+            }
+
+            const char *text_end = static_cast<const char*>(std::memchr(p_, '<', end_ - p_));
+            p_ = text_end ? text_end : end_;
+
+            expectCloseTag(child);
+        }
+
+        expectCloseTag(name);
+        finishMatrix(node, channels, has_data);
+    }
+
+    // --- both ---
+
+    // dt is a type like "d" or "3d", optionally quoted, the count is the number of channels
+    int dataChannels()
+    {
+        if (*p_ == '"') {
+            p_++;
+        }
+
+        int channels = std::isdigit(static_cast<unsigned char>(*p_)) ? std::strtol(p_, nullptr, 10) : 1;
+        return channels > 0 ? channels : 1;
+    }
+
+    void finishMatrix(StorageNode &node, int channels, bool has_data)
+    {
+        node.cols *= channels;
+
+        if (!has_data || node.rows < 0 || node.cols < 0 || node.values.size() != static_cast<size_t>(node.rows) * node.cols) {
+            fail("matrix of " + std::to_string(node.rows) + "x" + std::to_string(node.cols) + " with " +
+                std::to_string(node.values.size()) + " values");
+        }
+    }
+
+    const char *begin_;
+    const char *p_;
+    const char *end_;
+    OpenCVStorage &storage_;
+};
+
+OpenCVStorage OpenCVStorage::load(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+
+    if (!file) {
+        throw std::runtime_error("Can't open " + filename);
+    }
+
+    std::string content(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+
+    if (!file.read(&content[0], content.size())) {
+        throw std::runtime_error("Can't read " + filename);
+    }
+
+    return parse(content, filename);
+}
+
+OpenCVStorage OpenCVStorage::parse(const std::string &content, const std::string &name)
+{
+    OpenCVStorage storage;
+    storage.name_ = name;
+
+    StorageParser parser(content, storage);
+    parser.parse();
+
+    return storage;
+}
+
+const StorageNode *OpenCVStorage::find(const std::string &key) const
+{
+    auto it = nodes_.find(key);
+    return it == nodes_.end() ? nullptr : &it->second;
+}
+
+const StorageNode &OpenCVStorage::node(const std::string &key, StorageNode::Type type) const
+{
+    static const char *type_names[] = {"a number", "a string", "a matrix", "a sequence"};
+
+    const StorageNode *node = find(key);
+
+    if (!node) {
+        throw std::runtime_error(name_ + " has no " + key);
+    }
+
+    if (node->type != type) {
+        throw std::runtime_error(name_ + ": " + key + " is not " + type_names[type]);
+    }
+
+    return *node;
+}
+
+double OpenCVStorage::number(const std::string &key, double fallback) const
+{
+    const StorageNode *node = find(key);
+    return node && node->type == StorageNode::Number ? node->values[0] : fallback;
+}
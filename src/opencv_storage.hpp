@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+// Top level entry of an OpenCV FileStorage file
+struct StorageNode
+{
+    enum Type
+    {
+        Number,
+        String,
+        Matrix, // !!opencv-matrix or type_id="opencv-matrix"
+        Sequence // YAML [ ] or - items, XML <_> items, of numbers, number sequences or matrices
+    };
+
+    Type type = Number;
+    std::string text; // String
+
+    // Number has one value, Matrix holds the data row-major, Sequence every number of every item
+    // in order, eg. a sequence of 3x1 rvecs gives 3 values per item
+    std::vector<double> values;
+
+    int rows = 0; // Matrix
+    int cols = 0; // Matrix, times the number of channels of dt, eg. 3 for a 1x1 "3d" matrix
+    size_t items = 0; // Sequence
+};
+
+// Reader for the files cv::FileStorage writes, YAML (%YAML:1.0) or XML (<opencv_storage>), as
+// output by cv::calibrateCamera samples and `fs << "name" << value`. It reads the whole file and
+// parses it in one pass, matrix data straight into a vector reserved from rows and cols, so
+// multi-million number files load at the speed of strtod.
+//
+// Only top level entries are kept. Nested maps and sequences of strings are skipped, nothing
+// in a calibration uses them.
+class OpenCVStorage
+{
+public:
+    // Format from the content, throws if the file can't be read or parsed
+    static OpenCVStorage load(const std::string &filename);
+
+    // From a YAML or XML string, name is used in errors
+    static OpenCVStorage parse(const std::string &content, const std::string &name = "<string>");
+
+    // nullptr if there is no entry
+    const StorageNode *find(const std::string &key) const;
+
+    // Throws if there is no entry or it isn't of type
+    const StorageNode &node(const std::string &key, StorageNode::Type type) const;
+
+    // Number entry, or the fallback if there is none
+    double number(const std::string &key, double fallback) const;
+
+    const std::string &name() const { return name_; }
+
+private:
+    std::string name_;
+    std::map<std::string, StorageNode> nodes_;
+
+    friend class StorageParser;
+};
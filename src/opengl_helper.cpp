@@ -1,9 +1,26 @@
 #include <GL/glew.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
 #include <sstream>
 #include <vector>
 
+#include "file_cache.hpp"
 #include "opengl_helper.hpp"
 
+// Last GL_CHECK location in DEBUG mode. The debug callback can run on a driver thread.
+static std::atomic<const GLCheckLocation*> last_location(nullptr);
+
+// First error reported by the debug callback since the last checkOpenGLFrame()
+static std::mutex debug_error_mutex;
+static std::string debug_error;
+
 void checkOpenGLError(const char* stmt, const char* fname, int line)
 {
    GLenum err = glGetError();
@@ -15,6 +32,80 @@ void checkOpenGLError(const char* stmt, const char* fname, int line)
     }
 }
 
+void setOpenGLCheckLocation(const GLCheckLocation *location)
+{
+    last_location.store(location, std::memory_order_relaxed);
+}
+
+void checkOpenGLFrame()
+{
+    {
+        std::lock_guard<std::mutex> lock(debug_error_mutex);
+
+        if (!debug_error.empty()) {
+            std::string err;
+            err.swap(debug_error);
+            throw std::runtime_error(err);
+        }
+    }
+
+    checkOpenGLError("frame", __FILE__, __LINE__);
+}
+
+static void GLAPIENTRY debugCallback(
+    GLenum source,
+    GLenum type,
+    GLuint id,
+    GLenum severity,
+    GLsizei length,
+    const GLchar *message,
+    const void *user_param)
+{
+    if (severity == GL_DEBUG_SEVERITY_NOTIFICATION) {
+        return;
+    }
+
+    std::stringstream ss;
+    ss << "OpenGL debug message " << id << ": " << message;
+
+    // Without synchronous output this is where the application was, not necessarily the culprit
+    const GLCheckLocation *location = last_location.load(std::memory_order_relaxed);
+
+    if (location) {
+        ss << " - near " << location->fname << ":" << location->line << " " << location->stmt;
+    }
+
+    std::cerr << ss.str() << "\n";
+
+    if (type == GL_DEBUG_TYPE_ERROR) {
+        std::lock_guard<std::mutex> lock(debug_error_mutex);
+
+        if (debug_error.empty()) {
+            debug_error = ss.str();
+        }
+    }
+}
+
+bool enableOpenGLDebugOutput(bool synchronous)
+{
+    if (!GLEW_KHR_debug) {
+        return false;
+    }
+
+    GL_CHECK(glEnable(GL_DEBUG_OUTPUT));
+
+    if (synchronous) {
+        GL_CHECK(glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS));
+    } else {
+        GL_CHECK(glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS));
+    }
+
+    GL_CHECK(glDebugMessageCallback(debugCallback, nullptr));
+    GL_CHECK(glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE));
+
+    return true;
+}
+
 static void checkShader(GLuint shader_id)
 {
     GLint result = GL_FALSE;
@@ -30,9 +121,142 @@ static void checkShader(GLuint shader_id)
     }
 }
 
+// Directory of cached program binaries, empty when disabled
+static std::string program_cache_dir;
+
+static const char PROGRAM_CACHE_MAGIC[4] = {'G', 'L', 'P', 'B'};
+
+static bool programBinarySupported()
+{
+    if (!GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1) {
+        return false;
+    }
+
+    GLint num_formats = 0;
+    GL_CHECK(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats));
+
+    return num_formats > 0;
+}
+
+// Over the sources and everything that identifies the driver
+static std::string programCacheKey(const std::string &vertex_shader_code, const std::string &fragment_shader_code)
+{
+    CacheKey key;
+    key.add(vertex_shader_code);
+    key.add(fragment_shader_code);
+    key.add(reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    key.add(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    key.add(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    key.add(reinterpret_cast<const char*>(glGetString(GL_SHADING_LANGUAGE_VERSION)));
+
+    return key.hex();
+}
+
+// Returns 0 if there is no usable binary, in which case a stale file is removed
+static GLuint loadProgramBinary(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    if (!file) {
+        return 0;
+    }
+
+    char magic[4];
+    uint32_t format;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+
+    if (!file || std::memcmp(magic, PROGRAM_CACHE_MAGIC, sizeof(magic)) != 0) {
+        std::remove(filename.c_str());
+        return 0;
+    }
+
+    // the rest of the file, istreambuf_iterator reads the buffer directly and leaves the stream state alone
+    std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (binary.empty()) {
+        std::remove(filename.c_str());
+        return 0;
+    }
+
+    // glProgramBinary raises GL_INVALID_ENUM on formats the driver no longer accepts
+    GLint num_formats = 0;
+    GL_CHECK(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats));
+
+    std::vector<GLint> formats(num_formats);
+    GL_CHECK(glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data()));
+
+    if (std::find(formats.begin(), formats.end(), static_cast<GLint>(format)) == formats.end()) {
+        std::remove(filename.c_str());
+        return 0;
+    }
+
+    GLuint program_id = glCreateProgram();
+    GL_CHECK(glProgramBinary(program_id, format, binary.data(), binary.size()));
+
+    GLint result = GL_FALSE;
+    GL_CHECK(glGetProgramiv(program_id, GL_LINK_STATUS, &result));
+
+    if (result != GL_TRUE) {
+        GL_CHECK(glDeleteProgram(program_id));
+        std::remove(filename.c_str());
+        return 0;
+    }
+
+    return program_id;
+}
+
+static void saveProgramBinary(GLuint program_id, const std::string &filename)
+{
+    GLint length = 0;
+    GL_CHECK(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length));
+
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format;
+    GL_CHECK(glGetProgramBinary(program_id, length, nullptr, &format, binary.data()));
+
+    uint32_t format32 = format;
+
+    bool written = replaceFile(filename, [&](std::ofstream &file) {
+        file.write(PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+        file.write(reinterpret_cast<const char*>(&format32), sizeof(format32));
+        file.write(binary.data(), binary.size());
+    });
+
+    if (!written) {
+        std::cerr << "Failed to write program binary " << filename << "\n";
+    }
+}
+
+void setProgramBinaryCache(const std::string &dir)
+{
+    program_cache_dir = dir;
+
+    if (!dir.empty() && !makeDirectories(dir)) {
+        std::cerr << "Can't create program binary cache " << dir << ", caching disabled\n";
+        program_cache_dir.clear();
+    }
+}
+
 // https://github.com/opengl-tutorials
 GLuint loadShaders(const std::string &vertex_shader_code, const std::string &fragment_shader_code)
 {
+    std::string cache_file;
+
+    if (!program_cache_dir.empty() && programBinarySupported()) {
+        cache_file = program_cache_dir + "/" + programCacheKey(vertex_shader_code, fragment_shader_code) + ".bin";
+
+        GLuint program_id = loadProgramBinary(cache_file);
+
+        if (program_id) {
+            return program_id;
+        }
+    }
+
  // Create the shaders
     GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
     GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
@@ -51,6 +275,11 @@ GLuint loadShaders(const std::string &vertex_shader_code, const std::string &fra
 
     // Link the program
     GLuint program_id = glCreateProgram();
+
+    if (!cache_file.empty()) {
+        GL_CHECK(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
+
     GL_CHECK(glAttachShader(program_id, vertex_shader_id));
     GL_CHECK(glAttachShader(program_id, fragment_shader_id));
     GL_CHECK(glLinkProgram(program_id));
@@ -71,5 +300,48 @@ GLuint loadShaders(const std::string &vertex_shader_code, const std::string &fra
     GL_CHECK(glDeleteShader(vertex_shader_id));
     GL_CHECK(glDeleteShader(fragment_shader_id));
 
+    if (!cache_file.empty()) {
+        saveProgramBinary(program_id, cache_file);
+    }
+
     return program_id;
 }
+
+std::string shaderWithDefines(const std::string &shader_code, const std::vector<std::string> &defines)
+{
+    size_t version = shader_code.find("#version");
+
+    if (version == std::string::npos) {
+        throw std::runtime_error("shaderWithDefines: no #version line");
+    }
+
+    size_t eol = shader_code.find('\n', version);
+    std::string ret = shader_code.substr(0, eol + 1);
+
+    for (const std::string &define : defines) {
+        ret += "#define " + define + "\n";
+    }
+
+    return ret + shader_code.substr(eol + 1);
+}
+
+GLuint createRemapTexture(const std::vector<float> &map, int width, int height)
+{
+    if (map.size() != static_cast<size_t>(width) * height * 2) {
+        throw std::runtime_error("createRemapTexture: map size does not match width x height");
+    }
+
+    GLuint texture;
+
+    GL_CHECK(glGenTextures(1, &texture));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, width, height, 0, GL_RG, GL_FLOAT, map.data()));
+
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+    return texture;
+}
@@ -1,14 +1,71 @@
 #pragma once
 
+#include <string>
+#include <vector>
+
+// GL_CHECK_MODE selects how GL_CHECK reports errors, set with cmake -DGL_CHECK_MODE=STRICT|DEBUG|RELEASE
+// - STRICT: glGetError after every statement, throws on the statement that failed
+// - DEBUG: errors are reported asynchronously through the KHR_debug callback, see enableOpenGLDebugOutput().
+//   GL_CHECK only records the location of the statement so the callback can print it.
+// - RELEASE: GL_CHECK compiles to the bare statement
+// In every mode checkOpenGLFrame() should be called once per frame to catch anything that slipped through.
+#define GL_CHECK_STRICT 0
+#define GL_CHECK_DEBUG 1
+#define GL_CHECK_RELEASE 2
+
+#ifndef GL_CHECK_MODE
+#define GL_CHECK_MODE GL_CHECK_STRICT
+#endif
+
+struct GLCheckLocation
+{
+    const char *stmt;
+    const char *fname;
+    int line;
+};
+
 void checkOpenGLError(const char* stmt, const char* fname, int line);
+void setOpenGLCheckLocation(const GLCheckLocation *location);
+
+// Throws if any error was raised since the last call, either by glGetError or the debug callback
+void checkOpenGLFrame();
+
+// Installs the KHR_debug message callback. Returns false if the context doesn't support it.
+// synchronous makes the driver report on the offending call, at a performance cost.
+bool enableOpenGLDebugOutput(bool synchronous = false);
 
 #ifdef GL_CHECK
 #error "GL_CHECK already defined somewhere else!"
 #endif
 
+#if GL_CHECK_MODE == GL_CHECK_STRICT
 #define GL_CHECK(stmt) do { \
         stmt; \
         checkOpenGLError(#stmt, __FILE__, __LINE__); \
     } while (0)
+#elif GL_CHECK_MODE == GL_CHECK_DEBUG
+#define GL_CHECK(stmt) do { \
+        static const GLCheckLocation gl_check_location = {#stmt, __FILE__, __LINE__}; \
+        setOpenGLCheckLocation(&gl_check_location); \
+        stmt; \
+    } while (0)
+#elif GL_CHECK_MODE == GL_CHECK_RELEASE
+#define GL_CHECK(stmt) do { \
+        stmt; \
+    } while (0)
+#else
+#error "Unknown GL_CHECK_MODE"
+#endif
 
 GLuint loadShaders(const std::string &vertex_shader_code, const std::string &fragment_shader_code);
+
+// Cache linked programs in dir with glGetProgramBinary, empty disables it. The key is a hash of the
+// shader sources and the GL vendor, renderer and version strings, so a driver update invalidates it.
+// loadShaders() falls back to compiling from source whenever a cached binary is rejected.
+void setProgramBinaryCache(const std::string &dir);
+
+// Insert "#define NAME" lines after the #version line to select #ifdef variants of a shader
+std::string shaderWithDefines(const std::string &shader_code, const std::vector<std::string> &defines);
+
+// RG32F texture holding an (s, t) lookup per pixel, eg. from computeUndistortMap()
+GLuint createRemapTexture(const std::vector<float> &map, int width, int height);
@@ -0,0 +1,460 @@
+#include <GL/glew.h>
+
+#include <cctype>
+#include <cstddef>
+#include <stdexcept>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "overlay_renderer.hpp"
+#include "opengl_helper.hpp"
+#include "shader.hpp"
+
+OverlayRenderer::OverlayRenderer(int image_width, int image_height, const Mesh &mesh) :
+    image_width_(image_width),
+    image_height_(image_height),
+    mesh_(mesh),
+    camera_(image_width, image_height, 1, 1, 0, 0),
+    camera_block_(0, sizeof(CameraBlock))
+{
+    GL_CHECK(glGenVertexArrays(1, &vertex_array_));
+    GL_CHECK(glBindVertexArray(vertex_array_));
+
+    // vertices and texcoord for the texture quad
+    float w = image_width;
+    float h = image_height;
+
+    const float vertices[] = {
+        0.0, 0.0,   0.0, 0.0,
+        0.0, h,     0.0, 1.0,
+        w, 0.0,     1.0, 0.0,
+        w, h,       1.0, 1.0};
+
+    GL_CHECK(glGenBuffers(1, &vertex_buffer_));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW));
+
+    GL_CHECK(glGenBuffers(1, &mesh_vertex_buffer_));
+    GL_CHECK(glGenBuffers(1, &mesh_color_buffer_));
+    GL_CHECK(glGenBuffers(1, &mesh_index_buffer_));
+    uploadMesh(mesh_);
+
+    // uploadMesh leaves no VAO bound, the attribute setup below is VAO state
+    GL_CHECK(glBindVertexArray(vertex_array_));
+
+    // per instance model matrix and color, interleaved
+    GL_CHECK(glGenBuffers(1, &instance_buffer_));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_));
+
+    for (int i = 0; i < 4; i++) {
+        GL_CHECK(glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, sizeof(OverlayInstance),
+            reinterpret_cast<const void*>(offsetof(OverlayInstance, model) + i*sizeof(glm::vec4))));
+        GL_CHECK(glVertexAttribDivisor(2 + i, 1));
+    }
+
+    GL_CHECK(glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(OverlayInstance),
+        reinterpret_cast<const void*>(offsetof(OverlayInstance, color))));
+    GL_CHECK(glVertexAttribDivisor(6, 1));
+
+    vertex_shader_.reset(new ShaderProgram(VERTEX_SHADER, FRAGMENT_SHADER));
+    instanced_shader_.reset(new ShaderProgram(shaderWithDefines(VERTEX_SHADER, {"INSTANCED"}), FRAGMENT_SHADER));
+
+    vertex_shader_->bindUniformBlock("Camera", 0);
+    instanced_shader_->bindUniformBlock("Camera", 0);
+
+    model_uniform_ = vertex_shader_->uniform<glm::mat4>("model");
+
+    setColorSpace(YuvColorSpace::BT601);
+
+    // grayscale is the common case, the other formats are compiled when first drawn
+    textureShader(PixelFormat::Gray8);
+
+    GL_CHECK(glEnableVertexAttribArray(0));
+    GL_CHECK(glEnableVertexAttribArray(1));
+    GL_CHECK(glBindVertexArray(0));
+}
+
+OverlayRenderer::~OverlayRenderer()
+{
+    glDeleteTextures(1, &remap_texture_);
+    glDeleteBuffers(1, &vertex_buffer_);
+    glDeleteBuffers(1, &mesh_vertex_buffer_);
+    glDeleteBuffers(1, &mesh_color_buffer_);
+    glDeleteBuffers(1, &mesh_index_buffer_);
+    glDeleteBuffers(1, &instance_buffer_);
+    glDeleteVertexArrays(1, &vertex_array_);
+}
+
+void OverlayRenderer::uploadMesh(const Mesh &mesh)
+{
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, mesh_vertex_buffer_));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size()*sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW));
+
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, mesh_color_buffer_));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, mesh.colors.size()*sizeof(float), mesh.colors.data(), GL_STATIC_DRAW));
+
+    GL_CHECK(glBindVertexArray(vertex_array_));
+    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_index_buffer_));
+    GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size()*sizeof(uint32_t), mesh.indices.data(), GL_STATIC_DRAW));
+    GL_CHECK(glBindVertexArray(0));
+
+    index_count_ = mesh.indices.size();
+}
+
+void OverlayRenderer::setCamera(const CameraModel &camera)
+{
+    if (camera.width() == image_width_ && camera.height() == image_height_) {
+        camera_ = camera;
+    } else {
+        camera_ = camera.scaled(image_width_, image_height_);
+    }
+
+    // force a Camera block upload on the next draw
+    block_viewport_width_ = -1;
+
+    // the remap and the distortion uniforms come from the camera
+    setDistortionMode(distortion_mode_, subdivisions_);
+}
+
+void OverlayRenderer::setDepthRange(float near_plane, float far_plane, DepthMode mode)
+{
+    if (mode == DepthMode::ReversedZ && !isReversedZSupported()) {
+        throw std::runtime_error("Reversed-Z needs GL 4.5 or ARB_clip_control");
+    }
+
+    near_plane_ = near_plane;
+    far_plane_ = far_plane;
+    depth_mode_ = mode;
+
+    block_viewport_width_ = -1;
+}
+
+bool OverlayRenderer::isReversedZSupported()
+{
+    return GLEW_VERSION_4_5 || GLEW_ARB_clip_control;
+}
+
+void OverlayRenderer::updateCameraBlock(int viewport_width, int viewport_height)
+{
+    if (viewport_width == block_viewport_width_ && viewport_height == block_viewport_height_) {
+        return;
+    }
+
+    CameraBlock block;
+
+    // pixels of the viewport are pixels of the image, the intrinsics apply as they are
+    block.projection = camera_.projection(viewport_width, viewport_height, near_plane_, far_plane_, depth_mode_);
+
+    // Flip the y-axis so (0,0) is at the top left corner of the viewport
+    block.image = glm::ortho(0.0f, static_cast<float>(viewport_width), static_cast<float>(viewport_height), 0.0f, -1.0f, 1.0f);
+
+    camera_block_.update(&block, sizeof(block));
+
+    block_viewport_width_ = viewport_width;
+    block_viewport_height_ = viewport_height;
+}
+
+void OverlayRenderer::setDistortionMode(DistortionMode mode, int subdivisions)
+{
+    distortion_mode_ = mode;
+    subdivisions_ = subdivisions;
+
+    const DistortionCoeffs &dist = camera_.distortion();
+
+    if (remap_texture_) {
+        GL_CHECK(glDeleteTextures(1, &remap_texture_));
+        remap_texture_ = 0;
+    }
+
+    if (mode == DistortionMode::UndistortImage) {
+        std::vector<float> remap = camera_.undistortMap();
+        remap_texture_ = createRemapTexture(remap, image_width_, image_height_);
+    }
+
+    // straight edges only bend if there are vertices along them
+    if (mode == DistortionMode::DistortGeometry) {
+        uploadMesh(subdivideMesh(mesh_, subdivisions));
+    } else {
+        uploadMesh(mesh_);
+    }
+
+    for (auto &texture_shader : texture_shaders_) {
+        updateTextureShader(texture_shader.first, *texture_shader.second);
+    }
+
+    // distortion0/1 can be optimised away by the compiler
+    for (ShaderProgram *program : {vertex_shader_.get(), instanced_shader_.get()}) {
+        program->use();
+        program->uniform<bool>("distort").set(mode == DistortionMode::DistortGeometry);
+
+        if (program->hasUniform("distortion0")) {
+            program->uniform<glm::vec4>("distortion0").set(glm::vec4(dist.k1, dist.k2, dist.p1, dist.p2));
+            program->uniform<glm::vec4>("distortion1").set(glm::vec4(dist.k3, dist.k4, dist.k5, dist.k6));
+        }
+    }
+}
+
+void OverlayRenderer::setColorSpace(YuvColorSpace color_space, bool full_range)
+{
+    float kr = color_space == YuvColorSpace::BT709 ? 0.2126f : 0.299f;
+    float kb = color_space == YuvColorSpace::BT709 ? 0.0722f : 0.114f;
+    float kg = 1.0f - kr - kb;
+
+    // NOTE: glm is column first then row, the columns are what Y, U and V contribute to RGB
+    yuv_to_rgb_[0] = glm::vec3(1.0f, 1.0f, 1.0f);
+    yuv_to_rgb_[1] = glm::vec3(0.0f, -2.0f*kb*(1.0f - kb)/kg, 2.0f*(1.0f - kb));
+    yuv_to_rgb_[2] = glm::vec3(2.0f*(1.0f - kr), -2.0f*kr*(1.0f - kr)/kg, 0.0f);
+    yuv_offset_ = glm::vec3(0.0f, 128.0f/255.0f, 128.0f/255.0f);
+
+    // limited range has luma in [16, 235] and chroma in [16, 240]
+    if (!full_range) {
+        yuv_to_rgb_[0] *= 255.0f/219.0f;
+        yuv_to_rgb_[1] *= 255.0f/224.0f;
+        yuv_to_rgb_[2] *= 255.0f/224.0f;
+        yuv_offset_.x = 16.0f/255.0f;
+    }
+
+    for (auto &texture_shader : texture_shaders_) {
+        updateTextureShader(texture_shader.first, *texture_shader.second);
+    }
+}
+
+void OverlayRenderer::setDemosaicMethod(DemosaicMethod method)
+{
+    demosaic_method_ = method;
+
+    if (demosaic_) {
+        demosaic_->setMethod(method);
+    }
+}
+
+ShaderProgram &OverlayRenderer::textureShader(PixelFormat format)
+{
+    std::unique_ptr<ShaderProgram> &program = texture_shaders_[format];
+
+    if (!program) {
+        std::vector<std::string> defines;
+
+        if (isYuv(format)) {
+            // NV12, I420 or YUYV
+            std::string name = pixelFormatName(format);
+
+            for (char &c : name) {
+                c = std::toupper(c);
+            }
+
+            defines.push_back(name);
+        } else if (isBayer(format)) {
+            // sampling the demosaiced texture, which already has the window/level applied
+            defines.push_back("RGB");
+        } else if (format == PixelFormat::Gray16UI) {
+            defines.push_back("UINT");
+        }
+
+        program.reset(new ShaderProgram(TEXTURE_VERTEX_SHADER, shaderWithDefines(TEXTURE_FRAGMENT_SHADER, defines)));
+        program->bindUniformBlock("Camera", 0);
+
+        program->use();
+        program->uniform<int>("ourTexture").set(FrameTextures::textureUnit(0));
+
+        for (const char *name : {"planeUV", "planeU"}) {
+            if (program->hasUniform(name)) {
+                program->uniform<int>(name).set(FrameTextures::textureUnit(1));
+            }
+        }
+
+        if (program->hasUniform("planeV")) {
+            program->uniform<int>("planeV").set(FrameTextures::textureUnit(2));
+        }
+
+        updateTextureShader(format, *program);
+    }
+
+    return *program;
+}
+
+void OverlayRenderer::setWindowLevel(float window, float level)
+{
+    window_ = window;
+    level_ = level;
+
+    for (auto &texture_shader : texture_shaders_) {
+        updateTextureShader(texture_shader.first, *texture_shader.second);
+    }
+}
+
+void OverlayRenderer::levelMapping(PixelFormat format, float &scale, float &offset) const
+{
+    float max_value = maxSampleValue(format);
+    float window = window_ > 0 ? window_ : max_value;
+    float level = window_ > 0 ? level_ : max_value / 2;
+
+    // normalised textures sample as value / max_value, integer and float ones as the value
+    bool normalised = format != PixelFormat::Gray16UI && format != PixelFormat::Gray32F;
+    float sample_to_value = normalised ? max_value : 1;
+
+    scale = sample_to_value / window;
+    offset = 0.5f - level / window;
+}
+
+void OverlayRenderer::updateTextureShader(PixelFormat format, ShaderProgram &program)
+{
+    program.use();
+    program.uniform<bool>("undistort").set(distortion_mode_ == DistortionMode::UndistortImage);
+
+    // these can be optimised away by the compiler
+    if (program.hasUniform("remapTexture")) {
+        program.uniform<int>("remapTexture").set(1);
+    }
+
+    if (program.hasUniform("levelScale")) {
+        float scale, offset;
+        levelMapping(format, scale, offset);
+
+        program.uniform<float>("levelScale").set(scale);
+        program.uniform<float>("levelOffset").set(offset);
+    }
+
+    if (program.hasUniform("yuvToRgb")) {
+        program.uniform<glm::mat3>("yuvToRgb").set(yuv_to_rgb_);
+        program.uniform<glm::vec3>("yuvOffset").set(yuv_offset_);
+    }
+}
+
+void OverlayRenderer::draw(const FrameTextures &image, const glm::mat4 &model, int viewport_width, int viewport_height)
+{
+    drawBackground(image, viewport_width, viewport_height);
+    beginMesh();
+
+    vertex_shader_->use();
+    model_uniform_.set(model);
+
+    GL_CHECK(glDrawElements(GL_TRIANGLES, index_count_, GL_UNSIGNED_INT, 0));
+
+    endMesh();
+}
+
+void OverlayRenderer::draw(const FrameTextures &image, const std::vector<OverlayInstance> &instances, int viewport_width, int viewport_height)
+{
+    drawBackground(image, viewport_width, viewport_height);
+
+    if (instances.empty()) {
+        return;
+    }
+
+    // respecify the whole buffer each frame so the driver can orphan the previous one
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, instances.size()*sizeof(OverlayInstance), instances.data(), GL_STREAM_DRAW));
+
+    beginMesh();
+
+    for (GLuint i = 2; i <= 6; i++) {
+        GL_CHECK(glEnableVertexAttribArray(i));
+    }
+
+    instanced_shader_->use();
+    GL_CHECK(glDrawElementsInstanced(GL_TRIANGLES, index_count_, GL_UNSIGNED_INT, 0, instances.size()));
+
+    for (GLuint i = 2; i <= 6; i++) {
+        GL_CHECK(glDisableVertexAttribArray(i));
+    }
+
+    endMesh();
+}
+
+void OverlayRenderer::drawPerInstance(const FrameTextures &image, const std::vector<OverlayInstance> &instances,
+    int viewport_width, int viewport_height)
+{
+    drawBackground(image, viewport_width, viewport_height);
+    beginMesh();
+
+    vertex_shader_->use();
+
+    for (const OverlayInstance &instance : instances) {
+        model_uniform_.set(instance.model);
+        GL_CHECK(glDrawElements(GL_TRIANGLES, index_count_, GL_UNSIGNED_INT, 0));
+    }
+
+    endMesh();
+}
+
+void OverlayRenderer::drawBackground(const FrameTextures &image, int viewport_width, int viewport_height)
+{
+    // before anything touches the current framebuffer, the pass renders into its own
+    if (isBayer(image.format())) {
+        // sized for the image, again whenever its size changes
+        if (!demosaic_ || demosaic_->width() != image.width() || demosaic_->height() != image.height()) {
+            demosaic_.reset(new BayerDemosaic(image.width(), image.height(), demosaic_method_));
+        }
+
+        float scale, offset;
+        levelMapping(image.format(), scale, offset);
+
+        demosaic_->setLevels(scale, offset);
+        demosaic_->process(image);
+    }
+
+    GL_CHECK(glBindVertexArray(vertex_array_));
+    GL_CHECK(glViewport(0, 0, viewport_width, viewport_height));
+    GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
+
+    updateCameraBlock(viewport_width, viewport_height);
+    camera_block_.bind();
+
+    textureShader(image.format()).use();
+
+    GL_CHECK(glActiveTexture(GL_TEXTURE1));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, remap_texture_));
+
+    if (demosaic_ && isBayer(image.format())) {
+        GL_CHECK(glActiveTexture(GL_TEXTURE0));
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, demosaic_->output()));
+    } else {
+        image.bind();
+    }
+
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_));
+    GL_CHECK(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr));
+    GL_CHECK(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+    GL_CHECK(glBindVertexArray(0));
+}
+
+void OverlayRenderer::beginMesh()
+{
+    GL_CHECK(glBindVertexArray(vertex_array_));
+
+    GL_CHECK(glEnable(GL_DEPTH_TEST));
+
+    if (depth_mode_ == DepthMode::ReversedZ) {
+        GL_CHECK(glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE));
+        GL_CHECK(glDepthFunc(GL_GREATER));
+        GL_CHECK(glClearDepth(0.0));
+    }
+
+    GL_CHECK(glClear(GL_DEPTH_BUFFER_BIT));
+
+    GL_CHECK(glEnable(GL_BLEND));
+    GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, mesh_vertex_buffer_));
+    GL_CHECK(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr));
+
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, mesh_color_buffer_));
+    GL_CHECK(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, nullptr));
+}
+
+void OverlayRenderer::endMesh()
+{
+    // back to the GL defaults for everything else drawing into the context
+    if (depth_mode_ == DepthMode::ReversedZ) {
+        GL_CHECK(glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE));
+        GL_CHECK(glDepthFunc(GL_LESS));
+        GL_CHECK(glClearDepth(1.0));
+    }
+
+    GL_CHECK(glDisable(GL_DEPTH_TEST));
+    GL_CHECK(glDisable(GL_BLEND));
+    GL_CHECK(glBindVertexArray(0));
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "bayer_demosaic.hpp"
+#include "camera_model.hpp"
+#include "camera_projection.hpp"
+#include "frame_textures.hpp"
+#include "mesh.hpp"
+#include "shader_program.hpp"
+
+// How lens distortion is handled when compositing the overlay onto the camera image
+enum class DistortionMode
+{
+    None, // image is already undistorted eg. cv::undistort
+    UndistortImage, // undistort every background pixel through a remap texture, O(pixels)
+    DistortGeometry // show the raw image and distort the overlay vertices instead, O(vertices)
+};
+
+// One copy of the mesh in an instanced draw, color multiplies the mesh vertex colors
+struct OverlayInstance
+{
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+// Draws the camera image as a background quad and a mesh projected through the camera on top
+// of it, alpha blended and depth tested. YUV images are converted to RGB in the shader, Bayer
+// images are demosaiced into an intermediate texture first. The mesh goes through a perspective
+// projection built from the intrinsics, see perspectiveFromIntrinsics().
+class OverlayRenderer
+{
+public:
+    OverlayRenderer(int image_width, int image_height, const Mesh &mesh);
+    ~OverlayRenderer();
+
+    OverlayRenderer(const OverlayRenderer&) = delete;
+    OverlayRenderer& operator=(const OverlayRenderer&) = delete;
+
+    // Intrinsics and distortion of the camera the image comes from, scaled to the image size if
+    // it was calibrated at another resolution. Identity intrinsics by default.
+    void setCamera(const CameraModel &camera);
+    const CameraModel &camera() const { return camera_; }
+
+    // Camera z range that is drawn, in the units of the model matrix, 1 cm to 10 m by default.
+    // ReversedZ throws if isReversedZSupported() is false, it only gains precision with a float
+    // depth buffer like the one of Framebuffer.
+    void setDepthRange(float near_plane, float far_plane, DepthMode mode = DepthMode::Standard);
+
+    // ReversedZ needs glClipControl, GL 4.5 or ARB_clip_control
+    static bool isReversedZSupported();
+
+    // How the distortion of the camera is handled, None by default. subdivisions is only used by
+    // DistortionMode::DistortGeometry.
+    void setDistortionMode(DistortionMode mode, int subdivisions = 4);
+
+    // Conversion for YUV images, BT.601 limited range by default
+    void setColorSpace(YuvColorSpace color_space, bool full_range = false);
+
+    // For Bayer images, Malvar-He-Cutler by default
+    void setDemosaicMethod(DemosaicMethod method);
+
+    // Window/level for grayscale and Bayer images in sample values of the image format, see
+    // maxSampleValue(). eg. window 4096 and level 2048 for a 12-bit camera. A window of 0
+    // shows the full range of the format, which is the default.
+    void setWindowLevel(float window, float level);
+
+    // model is the pose of the mesh in the camera frame, eg. the checkerboard extrinsics
+    void draw(const FrameTextures &image, const glm::mat4 &model, int viewport_width, int viewport_height);
+
+    // Draws every instance of the mesh with a single glDrawElementsInstanced
+    void draw(const FrameTextures &image, const std::vector<OverlayInstance> &instances, int viewport_width, int viewport_height);
+
+    // The same with a glDrawElements and a model uniform update per instance, the colors are
+    // ignored. The baseline the instanced draw is measured against.
+    void drawPerInstance(const FrameTextures &image, const std::vector<OverlayInstance> &instances, int viewport_width,
+        int viewport_height);
+
+private:
+    void uploadMesh(const Mesh &mesh);
+    void drawBackground(const FrameTextures &image, int viewport_width, int viewport_height);
+
+    // Background shader for a pixel format, compiled on first use
+    ShaderProgram &textureShader(PixelFormat format);
+    void updateTextureShader(PixelFormat format, ShaderProgram &program);
+
+    // scale and offset that map the window of format to [0, 1], from what the shader samples
+    void levelMapping(PixelFormat format, float &scale, float &offset) const;
+
+    void beginMesh();
+    void endMesh();
+    void updateCameraBlock(int viewport_width, int viewport_height);
+
+    int image_width_;
+    int image_height_;
+
+    Mesh mesh_;
+    GLsizei index_count_ = 0;
+
+    CameraModel camera_;
+
+    float near_plane_ = 0.01f;
+    float far_plane_ = 10.0f;
+    DepthMode depth_mode_ = DepthMode::Standard;
+
+    DistortionMode distortion_mode_ = DistortionMode::None;
+    int subdivisions_ = 4;
+
+    glm::mat3 yuv_to_rgb_;
+    glm::vec3 yuv_offset_;
+
+    float window_ = 0;
+    float level_ = 0;
+
+    DemosaicMethod demosaic_method_ = DemosaicMethod::MalvarHeCutler;
+    std::unique_ptr<BayerDemosaic> demosaic_; // sized for the current Bayer image
+
+    GLuint vertex_array_ = 0;
+    GLuint vertex_buffer_ = 0;
+    GLuint mesh_vertex_buffer_ = 0;
+    GLuint mesh_color_buffer_ = 0;
+    GLuint mesh_index_buffer_ = 0;
+    GLuint instance_buffer_ = 0;
+    GLuint remap_texture_ = 0;
+
+    std::unique_ptr<ShaderProgram> vertex_shader_;
+    std::unique_ptr<ShaderProgram> instanced_shader_;
+    std::map<PixelFormat, std::unique_ptr<ShaderProgram>> texture_shaders_;
+
+    // std140 layout of the Camera uniform block
+    struct CameraBlock
+    {
+        glm::mat4 projection;
+        glm::mat4 image;
+    };
+
+    UniformBuffer camera_block_;
+    int block_viewport_width_ = -1;
+    int block_viewport_height_ = -1;
+
+    Uniform<glm::mat4> model_uniform_;
+};
@@ -0,0 +1,249 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "pixel_format.hpp"
+
+static PlaneLayout plane(size_t offset, size_t stride, int width, int height, int channels, int bytes_per_channel = 1)
+{
+    PlaneLayout layout;
+    layout.offset = offset;
+    layout.stride = stride;
+    layout.width = width;
+    layout.height = height;
+    layout.channels = channels;
+    layout.bytes_per_channel = bytes_per_channel;
+
+    return layout;
+}
+
+std::vector<PlaneLayout> planeLayout(PixelFormat format, int width, int height, size_t stride)
+{
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("Invalid frame size");
+    }
+
+    if ((isYuv(format) || isBayer(format)) && (width % 2 || height % 2)) {
+        throw std::runtime_error(std::string(pixelFormatName(format)) + " frames need an even width and height");
+    }
+
+    std::vector<PlaneLayout> planes;
+
+    switch (format) {
+        case PixelFormat::Gray8:
+            stride = stride ? stride : width;
+            planes.push_back(plane(0, stride, width, height, 1));
+            break;
+
+        case PixelFormat::Gray16:
+        case PixelFormat::Gray16UI:
+            stride = stride ? stride : width * 2;
+            planes.push_back(plane(0, stride, width, height, 1, 2));
+            break;
+
+        case PixelFormat::Gray32F:
+            stride = stride ? stride : width * 4;
+            planes.push_back(plane(0, stride, width, height, 1, 4));
+            break;
+
+        case PixelFormat::NV12:
+            stride = stride ? stride : width;
+            planes.push_back(plane(0, stride, width, height, 1));
+            planes.push_back(plane(stride * height, stride, width / 2, height / 2, 2));
+            break;
+
+        case PixelFormat::I420:
+            stride = stride ? stride : width;
+            planes.push_back(plane(0, stride, width, height, 1));
+            planes.push_back(plane(stride * height, stride / 2, width / 2, height / 2, 1));
+            planes.push_back(plane(stride * height + stride / 2 * height / 2, stride / 2, width / 2, height / 2, 1));
+            break;
+
+        case PixelFormat::YUYV:
+            stride = stride ? stride : width * 2;
+            planes.push_back(plane(0, stride, width / 2, height, 4));
+            break;
+
+        case PixelFormat::BayerRGGB8:
+        case PixelFormat::BayerBGGR8:
+        case PixelFormat::BayerGRBG8:
+        case PixelFormat::BayerGBRG8:
+            stride = stride ? stride : width;
+            planes.push_back(plane(0, stride, width, height, 1));
+            break;
+
+        case PixelFormat::BayerRGGB16:
+        case PixelFormat::BayerBGGR16:
+        case PixelFormat::BayerGRBG16:
+        case PixelFormat::BayerGBRG16:
+            stride = stride ? stride : width * 2;
+            planes.push_back(plane(0, stride, width, height, 1, 2));
+            break;
+    }
+
+    if (planes.empty() || stride < static_cast<size_t>(planes[0].width * planes[0].channels * planes[0].bytes_per_channel)) {
+        throw std::runtime_error("Stride too small for the frame width");
+    }
+
+    return planes;
+}
+
+size_t frameSize(PixelFormat format, int width, int height, size_t stride)
+{
+    std::vector<PlaneLayout> planes = planeLayout(format, width, height, stride);
+    const PlaneLayout &last = planes.back();
+
+    return last.offset + last.stride * last.height;
+}
+
+void copyFrame(unsigned char *dst, const unsigned char *src, PixelFormat format, int width, int height, size_t stride)
+{
+    std::vector<PlaneLayout> src_planes = planeLayout(format, width, height, stride);
+    std::vector<PlaneLayout> dst_planes = planeLayout(format, width, height);
+
+    if (src_planes[0].stride == dst_planes[0].stride) {
+        std::memcpy(dst, src, frameSize(format, width, height));
+        return;
+    }
+
+    for (size_t i = 0; i < src_planes.size(); i++) {
+        const PlaneLayout &s = src_planes[i];
+        const PlaneLayout &d = dst_planes[i];
+
+        for (int y = 0; y < s.height; y++) {
+            std::memcpy(dst + d.offset + y*d.stride, src + s.offset + y*s.stride, d.stride);
+        }
+    }
+}
+
+std::vector<unsigned char> blackFrame(PixelFormat format, int width, int height)
+{
+    std::vector<unsigned char> frame(frameSize(format, width, height), 0);
+    std::vector<PlaneLayout> planes = planeLayout(format, width, height);
+
+    // zero chroma is 128, luma is left at 0 which clamps to black in limited range too
+    switch (format) {
+        case PixelFormat::NV12:
+        case PixelFormat::I420:
+            std::memset(frame.data() + planes[1].offset, 128, frame.size() - planes[1].offset);
+            break;
+
+        case PixelFormat::YUYV:
+            for (size_t i = 1; i < frame.size(); i += 2) {
+                frame[i] = 128;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return frame;
+}
+
+bool isYuv(PixelFormat format)
+{
+    return format == PixelFormat::NV12 || format == PixelFormat::I420 || format == PixelFormat::YUYV;
+}
+
+bool isBayer(PixelFormat format)
+{
+    return format >= PixelFormat::BayerRGGB8 && format <= PixelFormat::BayerGBRG16;
+}
+
+void bayerRedOffset(PixelFormat format, int &x, int &y)
+{
+    switch (format) {
+        case PixelFormat::BayerRGGB8:
+        case PixelFormat::BayerRGGB16:
+            x = 0;
+            y = 0;
+            break;
+        case PixelFormat::BayerGRBG8:
+        case PixelFormat::BayerGRBG16:
+            x = 1;
+            y = 0;
+            break;
+        case PixelFormat::BayerGBRG8:
+        case PixelFormat::BayerGBRG16:
+            x = 0;
+            y = 1;
+            break;
+        case PixelFormat::BayerBGGR8:
+        case PixelFormat::BayerBGGR16:
+            x = 1;
+            y = 1;
+            break;
+        default:
+            throw std::runtime_error(std::string(pixelFormatName(format)) + " is not a Bayer format");
+    }
+}
+
+double maxSampleValue(PixelFormat format)
+{
+    switch (format) {
+        case PixelFormat::Gray32F:
+            return 1;
+
+        case PixelFormat::Gray16:
+        case PixelFormat::Gray16UI:
+        case PixelFormat::BayerRGGB16:
+        case PixelFormat::BayerBGGR16:
+        case PixelFormat::BayerGRBG16:
+        case PixelFormat::BayerGBRG16:
+            return 65535;
+
+        default:
+            return 255;
+    }
+}
+
+PixelFormat parsePixelFormat(const std::string &name)
+{
+    for (int i = 0; i <= static_cast<int>(PixelFormat::BayerGBRG16); i++) {
+        PixelFormat format = static_cast<PixelFormat>(i);
+
+        if (name == pixelFormatName(format)) {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("Unknown pixel format " + name);
+}
+
+const char *pixelFormatName(PixelFormat format)
+{
+    switch (format) {
+        case PixelFormat::Gray8:
+            return "gray8";
+        case PixelFormat::Gray16:
+            return "gray16";
+        case PixelFormat::Gray16UI:
+            return "gray16ui";
+        case PixelFormat::Gray32F:
+            return "gray32f";
+        case PixelFormat::NV12:
+            return "nv12";
+        case PixelFormat::I420:
+            return "i420";
+        case PixelFormat::YUYV:
+            return "yuyv";
+        case PixelFormat::BayerRGGB8:
+            return "rggb8";
+        case PixelFormat::BayerBGGR8:
+            return "bggr8";
+        case PixelFormat::BayerGRBG8:
+            return "grbg8";
+        case PixelFormat::BayerGBRG8:
+            return "gbrg8";
+        case PixelFormat::BayerRGGB16:
+            return "rggb16";
+        case PixelFormat::BayerBGGR16:
+            return "bggr16";
+        case PixelFormat::BayerGRBG16:
+            return "grbg16";
+        case PixelFormat::BayerGBRG16:
+            return "gbrg16";
+    }
+
+    return "unknown";
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Memory layout of a camera frame. The YUV formats are the usual single-buffer camera layouts,
+// planes follow each other with no gap.
+enum class PixelFormat
+{
+    Gray8,
+    Gray16, // native endian, sampled as normalised R16, 10 and 12-bit sensors use the low bits
+    Gray16UI, // same layout as Gray16, sampled as integers through an R16UI texture
+    Gray32F, // float, eg. radiometric thermal cameras
+    NV12, // Y plane, then interleaved UV at half width and height
+    I420, // Y plane, then U and V at half width and height
+    YUYV, // 4:2:2 packed, Y0 U Y1 V for every two pixels
+
+    // Raw sensor mosaic, one sample per pixel, named after the top left 2x2 tile.
+    // The 16-bit ones are native endian and use the full range.
+    BayerRGGB8,
+    BayerBGGR8,
+    BayerGRBG8,
+    BayerGBRG8,
+    BayerRGGB16,
+    BayerBGGR16,
+    BayerGRBG16,
+    BayerGBRG16
+};
+
+// Matrix for the YUV to RGB conversion
+enum class YuvColorSpace
+{
+    BT601, // SD cameras, most webcams
+    BT709 // HD
+};
+
+// One plane as it's uploaded to a texture. A texel can cover more than one pixel (YUYV).
+struct PlaneLayout
+{
+    size_t offset; // from the start of the frame
+    size_t stride; // bytes per row
+    int width; // in texels
+    int height;
+    int channels; // per texel
+    int bytes_per_channel;
+};
+
+// Planes of a width x height frame, stride is the bytes per row of the first plane, the chroma
+// strides follow from it. 0 for tightly packed. Throws if the size doesn't suit the format.
+std::vector<PlaneLayout> planeLayout(PixelFormat format, int width, int height, size_t stride = 0);
+
+// Bytes in a frame with the given stride
+size_t frameSize(PixelFormat format, int width, int height, size_t stride = 0);
+
+// Copy a frame with any stride to a tightly packed one
+void copyFrame(unsigned char *dst, const unsigned char *src, PixelFormat format, int width, int height, size_t stride);
+
+// Tightly packed frame that displays as black
+std::vector<unsigned char> blackFrame(PixelFormat format, int width, int height);
+
+bool isYuv(PixelFormat format);
+bool isBayer(PixelFormat format);
+
+// Largest sample value of the format, 1 for float. Window/level settings are in these units.
+double maxSampleValue(PixelFormat format);
+
+// Column and row of the red sample in the top left 2x2 tile of a Bayer format
+void bayerRedOffset(PixelFormat format, int &x, int &y);
+
+// "gray8", "gray16", "gray16ui", "gray32f", "nv12", "i420", "yuyv", or the Bayer tile and bit depth, eg. "rggb8" or "gbrg16"
+PixelFormat parsePixelFormat(const std::string &name);
+const char *pixelFormatName(PixelFormat format);
@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define POINT_PROJECTOR_X86
+#endif
+
+#include "point_projector.hpp"
+
+// Rows of the combined matrix and the arrays of one call, the kernels work on [begin, end)
+struct ProjectJob
+{
+    const float (*rows)[4];
+    const float *x;
+    const float *y;
+    const float *z;
+    float *u;
+    float *v;
+    float *depth;
+};
+
+static void projectScalar(const ProjectJob &job, size_t begin, size_t end)
+{
+    const float (*r)[4] = job.rows;
+
+    for (size_t i = begin; i < end; i++) {
+        float x = job.x[i];
+        float y = job.y[i];
+        float z = job.z[i];
+
+        float nu = r[0][0]*x + r[0][1]*y + r[0][2]*z + r[0][3];
+        float nv = r[1][0]*x + r[1][1]*y + r[1][2]*z + r[1][3];
+        float d = r[2][0]*x + r[2][1]*y + r[2][2]*z + r[2][3];
+
+        job.u[i] = nu / d;
+        job.v[i] = nv / d;
+
+        if (job.depth) {
+            job.depth[i] = d;
+        }
+    }
+}
+
+#ifdef POINT_PROJECTOR_X86
+
+// Same operations in the same order as projectScalar, so the results are bit-identical
+__attribute__((target("sse2")))
+static void projectSse(const ProjectJob &job, size_t begin, size_t end)
+{
+    const float (*r)[4] = job.rows;
+    __m128 m[3][4];
+
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 4; col++) {
+            m[row][col] = _mm_set1_ps(r[row][col]);
+        }
+    }
+
+    size_t i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(job.x + i);
+        __m128 y = _mm_loadu_ps(job.y + i);
+        __m128 z = _mm_loadu_ps(job.z + i);
+
+        __m128 out[3];
+
+        for (int row = 0; row < 3; row++) {
+            out[row] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[row][0], x), _mm_mul_ps(m[row][1], y)),
+                _mm_mul_ps(m[row][2], z)), m[row][3]);
+        }
+
+        _mm_storeu_ps(job.u + i, _mm_div_ps(out[0], out[2]));
+        _mm_storeu_ps(job.v + i, _mm_div_ps(out[1], out[2]));
+
+        if (job.depth) {
+            _mm_storeu_ps(job.depth + i, out[2]);
+        }
+    }
+
+    projectScalar(job, i, end);
+}
+
+__attribute__((target("avx2")))
+static void projectAvx2(const ProjectJob &job, size_t begin, size_t end)
+{
+    const float (*r)[4] = job.rows;
+    __m256 m[3][4];
+
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 4; col++) {
+            m[row][col] = _mm256_set1_ps(r[row][col]);
+        }
+    }
+
+    size_t i = begin;
+
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(job.x + i);
+        __m256 y = _mm256_loadu_ps(job.y + i);
+        __m256 z = _mm256_loadu_ps(job.z + i);
+
+        __m256 out[3];
+
+        for (int row = 0; row < 3; row++) {
+            out[row] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[row][0], x), _mm256_mul_ps(m[row][1], y)),
+                _mm256_mul_ps(m[row][2], z)), m[row][3]);
+        }
+
+        _mm256_storeu_ps(job.u + i, _mm256_div_ps(out[0], out[2]));
+        _mm256_storeu_ps(job.v + i, _mm256_div_ps(out[1], out[2]));
+
+        if (job.depth) {
+            _mm256_storeu_ps(job.depth + i, out[2]);
+        }
+    }
+
+    // fewer than 8 left
+    projectScalar(job, i, end);
+}
+
+#endif
+
+static void projectRange(SimdLevel level, const ProjectJob &job, size_t begin, size_t end)
+{
+    switch (level) {
+#ifdef POINT_PROJECTOR_X86
+        case SimdLevel::AVX2:
+            projectAvx2(job, begin, end);
+            break;
+        case SimdLevel::SSE:
+            projectSse(job, begin, end);
+            break;
+#endif
+        default:
+            projectScalar(job, begin, end);
+            break;
+    }
+}
+
+PointProjector::PointProjector(float fx, float fy, float cx, float cy, const glm::mat4 &model) :
+    fx_(fx),
+    fy_(fy),
+    cx_(cx),
+    cy_(cy),
+    model_(model),
+    simd_level_(bestSimdLevel())
+{
+    updateRows();
+}
+
+void PointProjector::setCamera(float fx, float fy, float cx, float cy, float skew)
+{
+    fx_ = fx;
+    fy_ = fy;
+    cx_ = cx;
+    cy_ = cy;
+    skew_ = skew;
+
+    updateRows();
+}
+
+void PointProjector::setModel(const glm::mat4 &model)
+{
+    model_ = model;
+
+    updateRows();
+}
+
+void PointProjector::updateRows()
+{
+    // NOTE: glm is column first then row
+    for (int col = 0; col < 4; col++) {
+        rows_[0][col] = fx_*model_[col][0] + skew_*model_[col][1] + cx_*model_[col][2];
+        rows_[1][col] = fy_*model_[col][1] + cy_*model_[col][2];
+        rows_[2][col] = model_[col][2];
+    }
+}
+
+void PointProjector::project(const float *x, const float *y, const float *z, size_t count, float *u, float *v, float *depth) const
+{
+    ProjectJob job = {rows_, x, y, z, u, v, depth};
+    projectRange(simd_level_, job, 0, count);
+}
+
+void PointProjector::projectParallel(const float *x, const float *y, const float *z, size_t count, float *u, float *v, float *depth,
+    unsigned num_threads) const
+{
+    // starting a thread costs about as much as projecting this many points
+    constexpr size_t min_points_per_thread = 64*1024;
+
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    num_threads = std::min<size_t>(num_threads, std::max<size_t>(1, count / min_points_per_thread));
+
+    if (num_threads == 1) {
+        project(x, y, z, count, u, v, depth);
+        return;
+    }
+
+    ProjectJob job = {rows_, x, y, z, u, v, depth};
+
+    // chunks are a multiple of 16 points, a cache line of floats, so with aligned arrays no two
+    // threads write the same line
+    size_t chunk = (count / num_threads + 15) / 16 * 16;
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 1; t < num_threads; t++) {
+        size_t begin = std::min(count, t * chunk);
+        size_t end = t + 1 == num_threads ? count : std::min(count, (t + 1) * chunk);
+
+        threads.emplace_back(projectRange, simd_level_, std::cref(job), begin, end);
+    }
+
+    // the first chunk on the calling thread
+    projectRange(simd_level_, job, 0, std::min(count, chunk));
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+void PointProjector::setSimdLevel(SimdLevel level)
+{
+    if (!isSupported(level)) {
+        throw std::runtime_error(std::string("PointProjector: ") + simdLevelName(level) + " is not supported on this CPU");
+    }
+
+    simd_level_ = level;
+}
+
+bool PointProjector::isSupported(SimdLevel level)
+{
+    switch (level) {
+        case SimdLevel::Scalar:
+            return true;
+#ifdef POINT_PROJECTOR_X86
+        case SimdLevel::SSE:
+            return __builtin_cpu_supports("sse2");
+        case SimdLevel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+SimdLevel PointProjector::bestSimdLevel()
+{
+    for (SimdLevel level : {SimdLevel::AVX2, SimdLevel::SSE}) {
+        if (isSupported(level)) {
+            return level;
+        }
+    }
+
+    return SimdLevel::Scalar;
+}
+
+const char *PointProjector::simdLevelName(SimdLevel level)
+{
+    switch (level) {
+        case SimdLevel::Scalar:
+            return "scalar";
+        case SimdLevel::SSE:
+            return "sse";
+        case SimdLevel::AVX2:
+            return "avx2";
+    }
+
+    return "unknown";
+}
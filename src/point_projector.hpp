@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+
+// Instruction sets PointProjector can use, each one also needs support from the CPU
+enum class SimdLevel
+{
+    Scalar,
+    SSE, // 4 points at a time, always there on x86-64
+    AVX2 // 8 points at a time
+};
+
+// CPU version of the projection in VERTEX_SHADER, for hit-testing, culling and exporting 2D
+// annotations. Each point goes through the model matrix and then the pinhole camera,
+//   p = model * (x, y, z, 1)
+//   u = (fx*p.x + skew*p.y + cx*p.z) / p.z
+//   v = (fy*p.y + cy*p.z) / p.z
+// giving pixels of the image with depth p.z, where perspectiveFromIntrinsics() puts them after
+// the viewport transform.
+// Lens distortion (DistortionMode::DistortGeometry) is not applied.
+//
+// Points are structure of arrays, a separate array per coordinate, so a SIMD register holds the
+// same coordinate of consecutive points. Every SimdLevel gives bit-identical results, there is
+// no FMA and the division is exact.
+class PointProjector
+{
+public:
+    PointProjector(float fx, float fy, float cx, float cy, const glm::mat4 &model = glm::mat4(1.0));
+
+    void setCamera(float fx, float fy, float cx, float cy, float skew = 0);
+    void setModel(const glm::mat4 &model);
+
+    // All arrays hold count floats, depth may be null. Points on the camera plane (p.z = 0)
+    // come out as inf or nan, like they would on the GPU.
+    void project(const float *x, const float *y, const float *z, size_t count, float *u, float *v, float *depth = nullptr) const;
+
+    // Same, split over num_threads threads, 0 for one per core. Small batches use fewer threads.
+    void projectParallel(const float *x, const float *y, const float *z, size_t count, float *u, float *v, float *depth = nullptr,
+        unsigned num_threads = 0) const;
+
+    // The best level is picked on construction, this forces another one eg. for benchmarks.
+    // Throws if the CPU doesn't support it.
+    void setSimdLevel(SimdLevel level);
+    SimdLevel simdLevel() const { return simd_level_; }
+
+    static bool isSupported(SimdLevel level);
+    static SimdLevel bestSimdLevel();
+    static const char *simdLevelName(SimdLevel level);
+
+private:
+    void updateRows();
+
+    float fx_;
+    float fy_;
+    float cx_;
+    float cy_;
+    float skew_ = 0;
+    glm::mat4 model_;
+
+    // camera * model, the rows giving the u and v numerators and depth from (x, y, z, 1)
+    float rows_[3][4];
+
+    SimdLevel simd_level_;
+};
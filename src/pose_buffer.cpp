@@ -0,0 +1,85 @@
+#include <algorithm>
+
+#include "pose_buffer.hpp"
+
+PoseBuffer::PoseBuffer(size_t capacity, int64_t max_extrapolation_ns) :
+    capacity_(std::max<size_t>(2, capacity)),
+    max_extrapolation_ns_(max_extrapolation_ns)
+{
+}
+
+void PoseBuffer::push(int64_t timestamp_ns, const glm::mat4 &pose)
+{
+    Sample sample;
+    sample.timestamp_ns = timestamp_ns;
+    sample.rotation = glm::normalize(glm::quat_cast(glm::mat3(pose)));
+    sample.translation = glm::vec3(pose[3]);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!samples_.empty() && timestamp_ns <= samples_.back().timestamp_ns) {
+        return;
+    }
+
+    if (samples_.size() == capacity_) {
+        samples_.pop_front();
+    }
+
+    samples_.push_back(sample);
+}
+
+bool PoseBuffer::sample(int64_t timestamp_ns, glm::mat4 &pose, int64_t *newest_ns) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (samples_.empty()) {
+        return false;
+    }
+
+    if (newest_ns) {
+        *newest_ns = samples_.back().timestamp_ns;
+    }
+
+    glm::quat rotation;
+    glm::vec3 translation;
+
+    if (samples_.size() == 1 || timestamp_ns <= samples_.front().timestamp_ns) {
+        rotation = samples_.front().rotation;
+        translation = samples_.front().translation;
+    } else {
+        // the two poses around the time, or the last two to extrapolate from
+        std::deque<Sample>::const_iterator b = samples_.end() - 1;
+
+        if (timestamp_ns < b->timestamp_ns) {
+            b = std::upper_bound(samples_.begin(), samples_.end(), timestamp_ns,
+                [](int64_t t, const Sample &sample) { return t < sample.timestamp_ns; });
+        } else {
+            timestamp_ns = std::min(timestamp_ns, b->timestamp_ns + max_extrapolation_ns_);
+        }
+
+        const Sample &a = *(b - 1);
+
+        // 0 to 1 between a and b, beyond 1 continues at the same angular and linear velocity
+        float s = static_cast<float>(static_cast<double>(timestamp_ns - a.timestamp_ns) / (b->timestamp_ns - a.timestamp_ns));
+
+        rotation = glm::normalize(glm::slerp(a.rotation, b->rotation, s));
+        translation = glm::mix(a.translation, b->translation, s);
+    }
+
+    pose = glm::mat4(glm::mat3_cast(rotation));
+    pose[3] = glm::vec4(translation, 1);
+
+    return true;
+}
+
+size_t PoseBuffer::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samples_.size();
+}
+
+void PoseBuffer::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_.clear();
+}
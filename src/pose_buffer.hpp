@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// Timestamped poses from a tracker, sampled at any time, eg. the predicted display time of a
+// frame when poses come slower than the display refreshes or arrive late. Timestamps are steady
+// clock nanoseconds like Frame::timestamp_ns.
+//
+// Between two poses the rotation is SLERPed and the translation interpolated linearly. Past the
+// newest pose both continue with the velocity between the last two, constant velocity
+// extrapolation, for at most max_extrapolation_ns. Before the oldest pose it is returned as is.
+//
+// push() and sample() can be called from different threads.
+class PoseBuffer
+{
+public:
+    explicit PoseBuffer(size_t capacity = 64, int64_t max_extrapolation_ns = 100000000);
+
+    // pose takes board points to the camera frame and is rigid. Poses that aren't newer than the
+    // newest one are dropped, the oldest one is dropped once the buffer is full.
+    void push(int64_t timestamp_ns, const glm::mat4 &pose);
+
+    // False if there are no poses yet. newest_ns, if given, gets the timestamp of the newest pose.
+    bool sample(int64_t timestamp_ns, glm::mat4 &pose, int64_t *newest_ns = nullptr) const;
+
+    size_t size() const;
+    void clear();
+
+private:
+    struct Sample
+    {
+        int64_t timestamp_ns;
+        glm::quat rotation;
+        glm::vec3 translation;
+    };
+
+    size_t capacity_;
+    int64_t max_extrapolation_ns_;
+
+    mutable std::mutex mutex_;
+    std::deque<Sample> samples_;
+};
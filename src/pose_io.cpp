@@ -0,0 +1,306 @@
+#include <sys/stat.h>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "file_cache.hpp"
+#include "opencv_storage.hpp"
+#include "pose_io.hpp"
+#include "rodrigues.hpp"
+
+static std::string pose_cache_dir;
+
+static const char POSE_CACHE_MAGIC[4] = {'P', 'O', 'S', 'C'};
+
+// Values per pose record, row-major rotation then translation
+static const size_t RECORD_SIZE = 12;
+
+static glm::mat4 poseFromValues(const double *v)
+{
+    // NOTE: glm is column first then row
+    glm::mat4 pose(1.0);
+
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            pose[col][row] = v[row*3 + col];
+        }
+
+        pose[3][row] = v[9 + row];
+    }
+
+    return pose;
+}
+
+static std::vector<glm::mat4> posesFromRecords(const std::vector<double> &records)
+{
+    std::vector<glm::mat4> poses;
+    poses.reserve(records.size() / RECORD_SIZE);
+
+    for (size_t i = 0; i + RECORD_SIZE <= records.size(); i += RECORD_SIZE) {
+        poses.push_back(poseFromValues(&records[i]));
+    }
+
+    return poses;
+}
+
+static bool endsWith(const std::string &str, const std::string &suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool isStorageFile(const std::string &filename)
+{
+    return endsWith(filename, ".yml") || endsWith(filename, ".yaml") || endsWith(filename, ".xml");
+}
+
+// Every number of a matrix or sequence entry, throws for anything else
+static const StorageNode &numbers(const OpenCVStorage &storage, const std::string &key)
+{
+    const StorageNode *node = storage.find(key);
+
+    if (node && node->type == StorageNode::Sequence) {
+        return *node;
+    }
+
+    return storage.node(key, StorageNode::Matrix);
+}
+
+static std::vector<glm::mat4> loadStoragePoses(const std::string &filename)
+{
+    OpenCVStorage storage = OpenCVStorage::load(filename);
+    std::vector<double> split;
+    const double *rvecs;
+    const double *tvecs;
+    size_t count;
+
+    if (storage.find("extrinsic_parameters")) {
+        const StorageNode &node = storage.node("extrinsic_parameters", StorageNode::Matrix);
+
+        if (node.cols != 6) {
+            throw std::runtime_error(filename + ": extrinsic_parameters should have 6 columns, rvec and tvec");
+        }
+
+        // rows of rvec then tvec, split into the two arrays posesFromRodrigues() takes
+        count = node.rows;
+        split.resize(count * 6);
+
+        for (size_t i = 0; i < count; i++) {
+            std::copy(&node.values[i*6], &node.values[i*6 + 3], &split[i*3]);
+            std::copy(&node.values[i*6 + 3], &node.values[i*6 + 6], &split[(count + i)*3]);
+        }
+
+        rvecs = split.data();
+        tvecs = split.data() + count*3;
+    } else {
+        // calibration files have rvecs and tvecs, a single pose (solvePnP) rvec and tvec
+        bool plural = storage.find("rvecs") != nullptr;
+        const StorageNode &rvec_node = numbers(storage, plural ? "rvecs" : "rvec");
+        const StorageNode &tvec_node = numbers(storage, plural ? "tvecs" : "tvec");
+
+        if (rvec_node.values.size() % 3 != 0 || rvec_node.values.size() != tvec_node.values.size()) {
+            throw std::runtime_error(filename + ": rvecs and tvecs should both have 3 values per pose");
+        }
+
+        count = rvec_node.values.size() / 3;
+        rvecs = rvec_node.values.data();
+        tvecs = tvec_node.values.data();
+    }
+
+    std::vector<glm::mat4> poses(count);
+    posesFromRodrigues(rvecs, tvecs, count, poses.data());
+
+    return poses;
+}
+
+// Raw float64 records, read in one go
+static std::vector<double> readRecords(std::ifstream &file, size_t count)
+{
+    std::vector<double> records(count * RECORD_SIZE);
+
+    if (!file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(double))) {
+        records.clear();
+    }
+
+    return records;
+}
+
+// Keyed by the absolute path
+static std::string poseCacheFile(const std::string &filename)
+{
+    char resolved[PATH_MAX];
+
+    CacheKey key;
+    key.add(realpath(filename.c_str(), resolved) ? resolved : filename.c_str());
+
+    return pose_cache_dir + "/" + key.hex() + ".poses";
+}
+
+struct PoseCacheHeader
+{
+    char magic[4];
+    uint32_t pose_size; // sizeof(glm::mat4)
+    uint64_t source_size;
+    int64_t source_mtime; // nanoseconds
+    uint64_t count;
+};
+
+// Empty if there is no cache matching the source, in which case a stale file is removed
+static std::vector<glm::mat4> loadCachedPoses(const std::string &cache_file, const struct stat &source)
+{
+    std::ifstream file(cache_file, std::ios::binary);
+
+    if (!file) {
+        return std::vector<glm::mat4>();
+    }
+
+    PoseCacheHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (!file || std::memcmp(header.magic, POSE_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.pose_size != sizeof(glm::mat4) ||
+        header.source_size != static_cast<uint64_t>(source.st_size) ||
+        header.source_mtime != source.st_mtim.tv_sec * 1000000000ll + source.st_mtim.tv_nsec) {
+        file.close();
+        std::remove(cache_file.c_str());
+        return std::vector<glm::mat4>();
+    }
+
+    // a count that doesn't match the file would allocate whatever it says
+    file.seekg(0, std::ios::end);
+    uint64_t pose_bytes = static_cast<uint64_t>(file.tellg()) - sizeof(header);
+
+    if (!file || header.count != pose_bytes / sizeof(glm::mat4) || pose_bytes % sizeof(glm::mat4) != 0) {
+        file.close();
+        std::remove(cache_file.c_str());
+        return std::vector<glm::mat4>();
+    }
+
+    file.seekg(sizeof(header));
+    std::vector<glm::mat4> poses(header.count);
+
+    if (!file.read(reinterpret_cast<char*>(poses.data()), poses.size() * sizeof(glm::mat4))) {
+        poses.clear();
+        file.close();
+        std::remove(cache_file.c_str());
+    }
+
+    return poses;
+}
+
+static void saveCachedPoses(const std::string &cache_file, const struct stat &source, const std::vector<glm::mat4> &poses)
+{
+    PoseCacheHeader header;
+    std::memcpy(header.magic, POSE_CACHE_MAGIC, sizeof(header.magic));
+    header.pose_size = sizeof(glm::mat4);
+    header.source_size = source.st_size;
+    header.source_mtime = source.st_mtim.tv_sec * 1000000000ll + source.st_mtim.tv_nsec;
+    header.count = poses.size();
+
+    bool written = replaceFile(cache_file, [&](std::ofstream &file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(poses.data()), poses.size() * sizeof(glm::mat4));
+    });
+
+    if (!written) {
+        std::cerr << "Failed to write pose cache " << cache_file << "\n";
+    }
+}
+
+void setPoseCache(const std::string &dir)
+{
+    pose_cache_dir = dir;
+
+    if (!dir.empty() && !makeDirectories(dir)) {
+        std::cerr << "Can't create pose cache " << dir << ", caching disabled\n";
+        pose_cache_dir.clear();
+    }
+}
+
+std::vector<glm::mat4> loadPoses(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    if (!file) {
+        throw std::runtime_error("Can't open " + filename);
+    }
+
+    if (isStorageFile(filename)) {
+        file.close();
+
+        struct stat source;
+
+        if (pose_cache_dir.empty() || stat(filename.c_str(), &source) != 0) {
+            return loadStoragePoses(filename);
+        }
+
+        std::string cache_file = poseCacheFile(filename);
+        std::vector<glm::mat4> poses = loadCachedPoses(cache_file, source);
+
+        if (poses.empty()) {
+            poses = loadStoragePoses(filename);
+            saveCachedPoses(cache_file, source, poses);
+        }
+
+        return poses;
+    }
+
+    if (!endsWith(filename, ".csv")) {
+        file.seekg(0, std::ios::end);
+        size_t size = file.tellg();
+        file.seekg(0);
+
+        if (size % (RECORD_SIZE * sizeof(double)) != 0) {
+            throw std::runtime_error(filename + " has a truncated pose record");
+        }
+
+        std::vector<double> records = readRecords(file, size / (RECORD_SIZE * sizeof(double)));
+
+        if (records.size() * sizeof(double) != size) {
+            throw std::runtime_error("Can't read " + filename);
+        }
+
+        return posesFromRecords(records);
+    }
+
+    std::vector<glm::mat4> poses;
+    double v[12];
+    std::string line;
+    int line_number = 0;
+
+    while (std::getline(file, line)) {
+        line_number++;
+        line = line.substr(0, line.find('#'));
+
+        for (char &c : line) {
+            if (c == ',') {
+                c = ' ';
+            }
+        }
+
+        std::istringstream ss(line);
+        int n = 0;
+
+        while (n < 12 && ss >> v[n]) {
+            n++;
+        }
+
+        if (n == 0) {
+            continue;
+        }
+
+        if (n != 12) {
+            throw std::runtime_error(filename + ":" + std::to_string(line_number) + " expected 12 values");
+        }
+
+        poses.push_back(poseFromValues(v));
+    }
+
+    return poses;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+
+#include <string>
+#include <vector>
+
+// Board poses in the camera frame, one per frame, as 4x4 model matrices.
+//
+// The formats:
+// - .csv: one pose per line, the row-major 3x3 rotation followed by the translation, comma or
+//   whitespace separated, # starts a comment
+// - .yml, .yaml, .xml: OpenCV FileStorage as written by the calibration samples, either
+//   extrinsic_parameters (N x 6, rvec then tvec per row) or rvecs and tvecs (N 3x1 matrices or
+//   sequences of 3 numbers), rvecs being Rodrigues rotation vectors
+// - anything else: raw little-endian float64 records of the same 12 values as .csv
+//
+// With setPoseCache(), YAML and XML are parsed once and then read back as binary records.
+std::vector<glm::mat4> loadPoses(const std::string &filename);
+
+// Cache parsed YAML and XML pose files in dir, empty disables it. A cached file is keyed by the
+// path and used while the source keeps its size and modification time.
+void setPoseCache(const std::string &dir);
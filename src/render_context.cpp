@@ -0,0 +1,504 @@
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#ifdef HAVE_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "render_context.hpp"
+#include "framebuffer.hpp"
+#include "opengl_helper.hpp"
+
+RenderContext::RenderContext(int width, int height) :
+    width_(width),
+    height_(height)
+{
+}
+
+RenderContext::~RenderContext()
+{
+}
+
+void RenderContext::initGL(bool offscreen)
+{
+    // GLEW looks up core profile entry points through the extension string otherwise
+    glewExperimental = GL_TRUE;
+
+    GLenum err = glewInit();
+
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW built for GLX still loads everything under EGL, it only fails to find a GLX display
+    if (err == GLEW_ERROR_NO_GLX_DISPLAY) {
+        err = GLEW_OK;
+    }
+#endif
+
+    if (GLEW_OK != err) {
+        throw std::runtime_error(std::string("glewInit error: ") + reinterpret_cast<const char*>(glewGetErrorString(err)));
+    }
+
+    // glewInit can leave GL_INVALID_ENUM behind on core profiles
+    glGetError();
+
+    std::cout << "Using GLEW " << glewGetString(GLEW_VERSION) << "\n";
+
+#if GL_CHECK_MODE == GL_CHECK_DEBUG
+    if (!enableOpenGLDebugOutput()) {
+        std::cerr << "KHR_debug not supported, errors are only checked once per frame\n";
+    }
+#endif
+
+    if (offscreen) {
+        framebuffer_.reset(new Framebuffer(width_, height_));
+    }
+}
+
+void RenderContext::beginFrame()
+{
+    if (framebuffer_) {
+        framebuffer_->bind();
+    } else {
+        Framebuffer::unbind();
+    }
+}
+
+void RenderContext::framebufferSize(int &width, int &height)
+{
+    width = width_;
+    height = height_;
+}
+
+GLuint RenderContext::framebuffer() const
+{
+    return framebuffer_ ? framebuffer_->id() : 0;
+}
+
+std::unique_ptr<SharedContext> RenderContext::createSharedContext()
+{
+    throw std::runtime_error(std::string("The ") + name() + " backend can't share its context");
+}
+
+namespace {
+
+void glfwErrorCallback(int error, const char* description)
+{
+    std::cerr << "glfw error: " << description << "\n";
+}
+
+void glfwKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
+    }
+}
+
+// Hidden 1x1 window, GLFW has no windowless contexts
+class GlfwSharedContext : public SharedContext
+{
+public:
+    explicit GlfwSharedContext(GLFWwindow *share)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        window_ = glfwCreateWindow(1, 1, "", NULL, share);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+        if (!window_) {
+            throw std::runtime_error("glfwCreateWindow failed for the shared context");
+        }
+    }
+
+    ~GlfwSharedContext()
+    {
+        glfwDestroyWindow(window_);
+    }
+
+    void makeCurrent()
+    {
+        glfwMakeContextCurrent(window_);
+    }
+
+    void doneCurrent()
+    {
+        glfwMakeContextCurrent(NULL);
+    }
+
+private:
+    GLFWwindow *window_ = nullptr;
+};
+
+class GlfwRenderContext : public RenderContext
+{
+public:
+    GlfwRenderContext(int width, int height, const char *title, bool vsync) :
+        RenderContext(width, height)
+    {
+        glfwSetErrorCallback(glfwErrorCallback);
+
+        if (!glfwInit()) {
+            throw std::runtime_error("glfwInit failed");
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#if GL_CHECK_MODE == GL_CHECK_DEBUG
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
+
+        window_ = glfwCreateWindow(width, height, title, NULL, NULL);
+
+        if (!window_) {
+            glfwTerminate();
+            throw std::runtime_error("glfwCreateWindow failed");
+        }
+
+        glfwMakeContextCurrent(window_);
+        glfwSetKeyCallback(window_, glfwKeyCallback);
+        glfwSwapInterval(vsync ? 1 : 0);
+
+        initGL(false);
+    }
+
+    ~GlfwRenderContext()
+    {
+        glfwDestroyWindow(window_);
+        glfwTerminate();
+    }
+
+    void makeCurrent()
+    {
+        glfwMakeContextCurrent(window_);
+    }
+
+    void endFrame()
+    {
+        glfwSwapBuffers(window_);
+        glfwPollEvents();
+    }
+
+    bool shouldClose()
+    {
+        return glfwWindowShouldClose(window_);
+    }
+
+    void framebufferSize(int &width, int &height)
+    {
+        glfwGetFramebufferSize(window_, &width, &height);
+    }
+
+    const char *name() const { return "glfw"; }
+
+    std::unique_ptr<SharedContext> createSharedContext()
+    {
+        return std::unique_ptr<SharedContext>(new GlfwSharedContext(window_));
+    }
+
+private:
+    GLFWwindow *window_ = nullptr;
+};
+
+#ifdef HAVE_EGL
+bool hasExtension(const char *extensions, const char *name)
+{
+    if (!extensions) {
+        return false;
+    }
+
+    size_t len = std::strlen(name);
+
+    for (const char *p = std::strstr(extensions, name); p; p = std::strstr(p + len, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0')) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const EGLint egl_context_attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+#if GL_CHECK_MODE == GL_CHECK_DEBUG
+    EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+#endif
+    EGL_NONE};
+
+class EglSharedContext : public SharedContext
+{
+public:
+    EglSharedContext(EGLDisplay display, EGLConfig config, EGLContext share, bool surfaceless) :
+        display_(display)
+    {
+        context_ = eglCreateContext(display_, config, share, egl_context_attribs);
+
+        if (context_ == EGL_NO_CONTEXT) {
+            throw std::runtime_error("EGL: can't create the shared context");
+        }
+
+        // a surface can only be current on one thread, so this one gets its own
+        if (!surfaceless) {
+            const EGLint pbuffer_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+            surface_ = eglCreatePbufferSurface(display_, config, pbuffer_attribs);
+        }
+    }
+
+    ~EglSharedContext()
+    {
+        eglDestroyContext(display_, context_);
+
+        if (surface_ != EGL_NO_SURFACE) {
+            eglDestroySurface(display_, surface_);
+        }
+    }
+
+    void makeCurrent()
+    {
+        if (!eglMakeCurrent(display_, surface_, surface_, context_)) {
+            throw std::runtime_error("eglMakeCurrent failed for the shared context");
+        }
+    }
+
+    void doneCurrent()
+    {
+        eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+
+private:
+    EGLDisplay display_;
+    EGLContext context_ = EGL_NO_CONTEXT;
+    EGLSurface surface_ = EGL_NO_SURFACE;
+};
+
+class EglRenderContext : public RenderContext
+{
+public:
+    EglRenderContext(int width, int height) :
+        RenderContext(width, height)
+    {
+        const char *client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+        // Prefer a display that needs neither X11 nor a GPU device node
+        if (hasExtension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+            PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+                reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+            if (getPlatformDisplay) {
+                display_ = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            }
+        }
+
+        if (display_ == EGL_NO_DISPLAY) {
+            display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+
+        if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, nullptr, nullptr)) {
+            throw std::runtime_error("EGL: no display");
+        }
+
+        surfaceless_ = hasExtension(eglQueryString(display_, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+        const EGLint config_attribs[] = {
+            EGL_SURFACE_TYPE, surfaceless_ ? 0 : EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_NONE};
+
+        EGLint num_configs = 0;
+
+        if (!eglChooseConfig(display_, config_attribs, &config_, 1, &num_configs) || num_configs == 0) {
+            eglTerminate(display_);
+            throw std::runtime_error("EGL: no OpenGL config");
+        }
+
+        eglBindAPI(EGL_OPENGL_API);
+
+        context_ = eglCreateContext(display_, config_, EGL_NO_CONTEXT, egl_context_attribs);
+
+        if (context_ == EGL_NO_CONTEXT) {
+            eglTerminate(display_);
+            throw std::runtime_error("EGL: can't create a GL 3.3 core context");
+        }
+
+        // we draw into a framebuffer object, the pbuffer is only there to make the context current
+        if (!surfaceless_) {
+            const EGLint pbuffer_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+            surface_ = eglCreatePbufferSurface(display_, config_, pbuffer_attribs);
+        }
+
+        makeCurrent();
+        initGL(true);
+    }
+
+    ~EglRenderContext()
+    {
+        framebuffer_.reset();
+
+        eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display_, context_);
+
+        if (surface_ != EGL_NO_SURFACE) {
+            eglDestroySurface(display_, surface_);
+        }
+
+        eglTerminate(display_);
+    }
+
+    void makeCurrent()
+    {
+        if (!eglMakeCurrent(display_, surface_, surface_, context_)) {
+            throw std::runtime_error("eglMakeCurrent failed");
+        }
+    }
+
+    void endFrame()
+    {
+        GL_CHECK(glFlush());
+    }
+
+    const char *name() const { return "egl"; }
+
+    std::unique_ptr<SharedContext> createSharedContext()
+    {
+        return std::unique_ptr<SharedContext>(new EglSharedContext(display_, config_, context_, surfaceless_));
+    }
+
+private:
+    EGLDisplay display_ = EGL_NO_DISPLAY;
+    EGLConfig config_ = nullptr;
+    bool surfaceless_ = false;
+    EGLContext context_ = EGL_NO_CONTEXT;
+    EGLSurface surface_ = EGL_NO_SURFACE;
+};
+#endif
+
+#ifdef HAVE_OSMESA
+// Mesa software rasterizer (llvmpipe) rendering into client memory, needs no GPU or display.
+// NOTE: GLEW has to be built for OSMesa (GLEW_OSMESA) to resolve entry points in this context.
+const int osmesa_context_attribs[] = {
+    OSMESA_FORMAT, OSMESA_RGBA,
+    OSMESA_DEPTH_BITS, 24,
+    OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+    OSMESA_CONTEXT_MAJOR_VERSION, 3,
+    OSMESA_CONTEXT_MINOR_VERSION, 3,
+    0};
+
+class OsMesaSharedContext : public SharedContext
+{
+public:
+    explicit OsMesaSharedContext(OSMesaContext share) :
+        buffer_(4)
+    {
+        context_ = OSMesaCreateContextAttribs(osmesa_context_attribs, share);
+
+        if (!context_) {
+            throw std::runtime_error("OSMesa: can't create the shared context");
+        }
+    }
+
+    ~OsMesaSharedContext()
+    {
+        OSMesaDestroyContext(context_);
+    }
+
+    void makeCurrent()
+    {
+        if (!OSMesaMakeCurrent(context_, buffer_.data(), GL_UNSIGNED_BYTE, 1, 1)) {
+            throw std::runtime_error("OSMesaMakeCurrent failed for the shared context");
+        }
+    }
+
+    void doneCurrent()
+    {
+        OSMesaMakeCurrent(nullptr, nullptr, 0, 0, 0);
+    }
+
+private:
+    OSMesaContext context_ = nullptr;
+    std::vector<unsigned char> buffer_;
+};
+
+class OsMesaRenderContext : public RenderContext
+{
+public:
+    OsMesaRenderContext(int width, int height) :
+        RenderContext(width, height),
+        buffer_(static_cast<size_t>(width) * height * 4)
+    {
+        context_ = OSMesaCreateContextAttribs(osmesa_context_attribs, nullptr);
+
+        if (!context_) {
+            throw std::runtime_error("OSMesa: can't create a GL 3.3 core context");
+        }
+
+        makeCurrent();
+        initGL(true);
+    }
+
+    ~OsMesaRenderContext()
+    {
+        framebuffer_.reset();
+        OSMesaDestroyContext(context_);
+    }
+
+    void makeCurrent()
+    {
+        if (!OSMesaMakeCurrent(context_, buffer_.data(), GL_UNSIGNED_BYTE, width_, height_)) {
+            throw std::runtime_error("OSMesaMakeCurrent failed");
+        }
+    }
+
+    void endFrame()
+    {
+        GL_CHECK(glFlush());
+    }
+
+    const char *name() const { return "osmesa"; }
+
+    std::unique_ptr<SharedContext> createSharedContext()
+    {
+        return std::unique_ptr<SharedContext>(new OsMesaSharedContext(context_));
+    }
+
+private:
+    OSMesaContext context_ = nullptr;
+    std::vector<unsigned char> buffer_;
+};
+#endif
+
+} // namespace
+
+std::unique_ptr<RenderContext> createRenderContext(const std::string &backend, int width, int height, const char *title, bool vsync)
+{
+    if (backend == "glfw") {
+        return std::unique_ptr<RenderContext>(new GlfwRenderContext(width, height, title, vsync));
+    }
+
+#ifdef HAVE_EGL
+    if (backend == "egl") {
+        return std::unique_ptr<RenderContext>(new EglRenderContext(width, height));
+    }
+#endif
+
+#ifdef HAVE_OSMESA
+    if (backend == "osmesa") {
+        return std::unique_ptr<RenderContext>(new OsMesaRenderContext(width, height));
+    }
+#endif
+
+    throw std::runtime_error("Render backend " + backend + " is not available");
+}
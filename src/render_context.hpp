@@ -0,0 +1,71 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <memory>
+#include <string>
+
+class Framebuffer;
+
+// Second context in the same share group as a RenderContext, for a worker thread. Textures,
+// buffers and sync objects are shared, container objects (VAO, FBO) are not. It has no surface
+// to draw to.
+class SharedContext
+{
+public:
+    virtual ~SharedContext() {}
+
+    virtual void makeCurrent() = 0;
+
+    // Detach the context from the calling thread
+    virtual void doneCurrent() = 0;
+};
+
+// Owns a GL 3.3 core context and the surface frames are drawn into. The window backend draws
+// to the default framebuffer, the headless ones draw into a Framebuffer object and are not
+// throttled by vsync.
+class RenderContext
+{
+public:
+    virtual ~RenderContext();
+
+    RenderContext(const RenderContext&) = delete;
+    RenderContext& operator=(const RenderContext&) = delete;
+
+    virtual void makeCurrent() = 0;
+
+    // Binds the framebuffer to draw into, call before drawing each frame
+    void beginFrame();
+
+    // Presents the frame, or just flushes for the headless backends
+    virtual void endFrame() = 0;
+
+    // Window closed or escape pressed, always false for the headless backends
+    virtual bool shouldClose() { return false; }
+
+    virtual void framebufferSize(int &width, int &height);
+
+    // GL framebuffer object the frame is drawn into, 0 for the default framebuffer
+    GLuint framebuffer() const;
+
+    virtual const char *name() const = 0;
+
+    // Call from the thread that owns this context, the result can be made current on any other.
+    // Throws if the backend can't share.
+    virtual std::unique_ptr<SharedContext> createSharedContext();
+
+protected:
+    RenderContext(int width, int height);
+
+    // Called by the backends once their context is current
+    void initGL(bool offscreen);
+
+    int width_;
+    int height_;
+    std::unique_ptr<Framebuffer> framebuffer_;
+};
+
+// backend is "glfw" for a window, "egl" for a headless EGL context (surfaceless or pbuffer) or
+// "osmesa" for software rendering. The headless ones are only available if found at build time.
+// title is only used by the window.
+std::unique_ptr<RenderContext> createRenderContext(const std::string &backend, int width, int height, const char *title, bool vsync = true);
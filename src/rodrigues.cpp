@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "rodrigues.hpp"
+
+// Unit axis, cos and sin of the angle. At angle zero the axis is rvec itself with cos = sin = 1,
+// which turns R = cos I + (1 - cos) k k^T + sin [k]x into the first order I + [rvec]x.
+static inline void rodriguesTerms(const double *rvec, double &x, double &y, double &z, double &c, double &s)
+{
+    double theta = std::sqrt(rvec[0]*rvec[0] + rvec[1]*rvec[1] + rvec[2]*rvec[2]);
+
+    if (theta < 1e-12) {
+        x = rvec[0];
+        y = rvec[1];
+        z = rvec[2];
+        c = 1;
+        s = 1;
+        return;
+    }
+
+    x = rvec[0] / theta;
+    y = rvec[1] / theta;
+    z = rvec[2] / theta;
+    c = std::cos(theta);
+    s = std::sin(theta);
+}
+
+void rotationFromRodrigues(const double rvec[3], double r[9])
+{
+    double x, y, z, c, s;
+    rodriguesTerms(rvec, x, y, z, c, s);
+
+    double t = 1 - c;
+
+    r[0] = c + t*x*x;
+    r[1] = t*x*y - s*z;
+    r[2] = t*x*z + s*y;
+
+    r[3] = t*x*y + s*z;
+    r[4] = c + t*y*y;
+    r[5] = t*y*z - s*x;
+
+    r[6] = t*x*z - s*y;
+    r[7] = t*y*z + s*x;
+    r[8] = c + t*z*z;
+}
+
+// Blocks of poses in two passes, first sqrt, sin and cos, then the matrices, which is plain
+// arithmetic over arrays the compiler vectorises
+static void convertRange(const double *rvecs, const double *tvecs, glm::mat4 *poses, size_t begin, size_t end)
+{
+    constexpr size_t block = 64;
+
+    double x[block];
+    double y[block];
+    double z[block];
+    double c[block];
+    double s[block];
+
+    for (size_t b = begin; b < end; b += block) {
+        size_t n = std::min(block, end - b);
+
+        for (size_t i = 0; i < n; i++) {
+            rodriguesTerms(rvecs + (b + i)*3, x[i], y[i], z[i], c[i], s[i]);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            const double *tvec = tvecs + (b + i)*3;
+            glm::mat4 &pose = poses[b + i];
+            double t = 1 - c[i];
+
+            // NOTE: glm is column first then row
+            pose[0][0] = c[i] + t*x[i]*x[i];
+            pose[0][1] = t*x[i]*y[i] + s[i]*z[i];
+            pose[0][2] = t*x[i]*z[i] - s[i]*y[i];
+            pose[0][3] = 0;
+
+            pose[1][0] = t*x[i]*y[i] - s[i]*z[i];
+            pose[1][1] = c[i] + t*y[i]*y[i];
+            pose[1][2] = t*y[i]*z[i] + s[i]*x[i];
+            pose[1][3] = 0;
+
+            pose[2][0] = t*x[i]*z[i] + s[i]*y[i];
+            pose[2][1] = t*y[i]*z[i] - s[i]*x[i];
+            pose[2][2] = c[i] + t*z[i]*z[i];
+            pose[2][3] = 0;
+
+            pose[3][0] = tvec[0];
+            pose[3][1] = tvec[1];
+            pose[3][2] = tvec[2];
+            pose[3][3] = 1;
+        }
+    }
+}
+
+glm::mat4 poseFromRodrigues(const double rvec[3], const double tvec[3])
+{
+    glm::mat4 pose;
+    convertRange(rvec, tvec, &pose, 0, 1);
+
+    return pose;
+}
+
+void posesFromRodrigues(const double *rvecs, const double *tvecs, size_t count, glm::mat4 *poses, unsigned num_threads)
+{
+    // starting a thread costs about as much as converting this many poses
+    constexpr size_t min_poses_per_thread = 16*1024;
+
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    num_threads = std::min<size_t>(num_threads, std::max<size_t>(1, count / min_poses_per_thread));
+
+    // chunks are whole blocks, a pose is a cache line so threads never share one
+    size_t chunk = (count / num_threads + 63) / 64 * 64;
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 1; t < num_threads; t++) {
+        size_t begin = std::min(count, t * chunk);
+        size_t end = t + 1 == num_threads ? count : std::min(count, (t + 1) * chunk);
+
+        threads.emplace_back(convertRange, rvecs, tvecs, poses, begin, end);
+    }
+
+    // the first chunk on the calling thread
+    convertRange(rvecs, tvecs, poses, 0, std::min(count, chunk));
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+
+// Poses as OpenCV outputs them from cv::calibrateCamera and cv::solvePnP: a rotation vector
+// (rvec), the rotation axis times the angle in radians, and a translation (tvec). They take
+// board points to the OpenCV camera frame,
+//   p_camera = R(rvec) * p + tvec
+// which is what the renderers take as the model matrix, perspectiveFromIntrinsics() does the
+// conversion to OpenGL.
+
+// Row-major 3x3 rotation matrix of rvec, like cv::Rodrigues
+void rotationFromRodrigues(const double rvec[3], double r[9]);
+
+// 4x4 model matrix of a single pose
+glm::mat4 poseFromRodrigues(const double rvec[3], const double tvec[3]);
+
+// Whole pose streams, rvecs and tvecs hold count x 3 values in the order OpenCV stores them.
+// Large batches are split over num_threads threads, 0 for one per core.
+void posesFromRodrigues(const double *rvecs, const double *tvecs, size_t count, glm::mat4 *poses, unsigned num_threads = 0);
@@ -7,23 +7,68 @@ static const std::string VERTEX_SHADER = R"###(
 layout(location = 0) in vec3 vertexPosition;
 layout(location = 1) in vec4 vertexColor;
 
-uniform mat4 projection;
-uniform mat4 camera;
+#ifdef INSTANCED
+// per instance, the mat4 takes up locations 2 to 5
+layout(location = 2) in mat4 instanceModel;
+layout(location = 6) in vec4 instanceColor;
+#else
 uniform mat4 model;
+#endif
+
+// shared with TEXTURE_VERTEX_SHADER, only changes with the viewport, intrinsics or depth range.
+// projection takes the camera frame to clip space, see perspectiveFromIntrinsics(), image takes
+// image pixels to clip space for the background.
+layout(std140) uniform Camera
+{
+    mat4 projection;
+    mat4 image;
+};
+
+// Optional forward OpenCV lens distortion, (k1, k2, p1, p2) and (k3, k4, k5, k6)
+uniform bool distort;
+uniform vec4 distortion0;
+uniform vec4 distortion1;
+
 out vec4 color;
 
-void main()
+vec2 distortPoint(vec2 p)
 {
-    // project to 2d
-    vec4 v = camera * model * vec4(vertexPosition, 1);
+    float k1 = distortion0.x;
+    float k2 = distortion0.y;
+    float p1 = distortion0.z;
+    float p2 = distortion0.w;
+    float k3 = distortion1.x;
+    float k4 = distortion1.y;
+    float k5 = distortion1.z;
+    float k6 = distortion1.w;
 
-    // NOTE: v.z is left untounched to maintain depth information!
-    v.xy /= v.z;
+    float r2 = dot(p, p);
+    float r4 = r2*r2;
+    float r6 = r4*r2;
+    float radial = (1.0 + k1*r2 + k2*r4 + k3*r6) / (1.0 + k4*r2 + k5*r4 + k6*r6);
 
-    // To NDC
-    gl_Position = projection * v;
+    return vec2(
+        p.x*radial + 2.0*p1*p.x*p.y + p2*(r2 + 2.0*p.x*p.x),
+        p.y*radial + p1*(r2 + 2.0*p.y*p.y) + 2.0*p2*p.x*p.y);
+}
 
+void main()
+{
+#ifdef INSTANCED
+    vec4 p = instanceModel * vec4(vertexPosition, 1);
+    color = vertexColor * instanceColor;
+#else
+    vec4 p = model * vec4(vertexPosition, 1);
     color = vertexColor;
+#endif
+
+    if (distort) {
+        // distort in normalized image coordinates, scaling back by z keeps the depth
+        p.xy = distortPoint(p.xy / p.z) * p.z;
+    }
+
+    // w = z, the perspective divide and near/far clipping happen after this
+    gl_Position = projection * p;
 }
 )###";
 
@@ -39,31 +84,180 @@ void main()
 }
 )###";
 
-// Texture shader, grayscale image only
+// Texture shader for the camera image, see TEXTURE_FRAGMENT_SHADER for the pixel formats
 const std::string TEXTURE_VERTEX_SHADER = R"###(
 #version 330 core
 layout(location = 0) in vec4 vertexPosTexCoord;
 
-uniform mat4 mvp;
+layout(std140) uniform Camera
+{
+    mat4 projection;
+    mat4 image;
+};
+
 out vec2 texCoord;
 
 void main()
 {
-    gl_Position = mvp * vec4(vertexPosTexCoord.x, vertexPosTexCoord.y, 0.0, 1.0);
+    gl_Position = image * vec4(vertexPosTexCoord.x, vertexPosTexCoord.y, 0.0, 1.0);
     texCoord = vertexPosTexCoord.zw;
 }
 )###";
 
+// The pixel format is picked with a define: none for grayscale, UINT for integer grayscale, NV12,
+// I420, YUYV or RGB. ourTexture is the first plane, the chroma planes are separate textures. RGB is
+// for images that were converted by an earlier pass, eg. demosaiced Bayer frames.
+// Grayscale goes through a window/level mapping so 16-bit and float frames can be shown as they are.
 const std::string TEXTURE_FRAGMENT_SHADER = R"###(
 #version 330 core
 
 in vec2 texCoord;
+
+#ifdef UINT
+uniform usampler2D ourTexture;
+#else
 uniform sampler2D ourTexture;
+#endif
+
+#if defined(NV12)
+uniform sampler2D planeUV;
+#elif defined(I420)
+uniform sampler2D planeU;
+uniform sampler2D planeV;
+#endif
+
+// rgb = yuvToRgb * (yuv - yuvOffset), BT.601 or BT.709, limited or full range
+uniform mat3 yuvToRgb;
+uniform vec3 yuvOffset;
+
+// gray = sample * levelScale + levelOffset, maps the window to [0, 1]
+uniform float levelScale;
+uniform float levelOffset;
+
+// Optional lens undistortion, remapTexture holds where to sample the distorted image
+uniform bool undistort;
+uniform sampler2D remapTexture;
+
+out vec4 color;
+
+vec3 cameraColor(vec2 coord)
+{
+#if defined(NV12)
+    vec3 yuv = vec3(texture(ourTexture, coord).r, texture(planeUV, coord).rg);
+#elif defined(I420)
+    vec3 yuv = vec3(texture(ourTexture, coord).r, texture(planeU, coord).r, texture(planeV, coord).r);
+#elif defined(YUYV)
+    // each texel holds two pixels as Y0 U Y1 V, pick the luma of the pixel we're on
+    ivec2 size = textureSize(ourTexture, 0);
+    ivec2 pixel = clamp(ivec2(coord * vec2(size.x * 2, size.y)), ivec2(0), ivec2(size.x * 2 - 1, size.y - 1));
+    vec4 texel = texelFetch(ourTexture, ivec2(pixel.x / 2, pixel.y), 0);
+    vec3 yuv = vec3((pixel.x & 1) == 0 ? texel.r : texel.b, texel.g, texel.a);
+#elif defined(RGB)
+    return texture(ourTexture, coord).rgb;
+#else
+    float gray = float(texture(ourTexture, coord).r);
+    return vec3(clamp(gray * levelScale + levelOffset, 0.0, 1.0));
+#endif
+
+#if defined(NV12) || defined(I420) || defined(YUYV)
+    return clamp(yuvToRgb * (yuv - yuvOffset), 0.0, 1.0);
+#endif
+}
+
+void main()
+{
+    vec2 coord = texCoord;
+
+    if (undistort) {
+        coord = texture(remapTexture, texCoord).xy;
+
+        if (any(lessThan(coord, vec2(0.0))) || any(greaterThan(coord, vec2(1.0)))) {
+            color = vec4(0.0, 0.0, 0.0, 1.0);
+            return;
+        }
+    }
+
+    color = vec4(cameraColor(coord), 1.0);
+}
+)###";
+// Full screen triangle from gl_VertexID, for passes that write every pixel of a render target
+const std::string FULLSCREEN_VERTEX_SHADER = R"###(
+#version 330 core
+
+void main()
+{
+    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
+)###";
+
+// Bayer mosaic to RGB, one output pixel per sensor pixel. Bilinear by default, define MALVAR for
+// Malvar, He and Cutler, "High-quality linear interpolation for demosaicing of Bayer-patterned
+// color images", 2004, which adds a Laplacian correction from the sample's own channel.
+const std::string DEMOSAIC_FRAGMENT_SHADER = R"###(
+#version 330 core
+
+uniform sampler2D rawTexture;
+
+// column and row of the red sample in the 2x2 tile
+uniform ivec2 redOffset;
+
+// applied to the normalised samples, eg. to stretch 12 bits in an R16 texture
+uniform float levelScale;
+uniform float levelOffset;
+
 out vec4 color;
 
+float fetch(ivec2 p)
+{
+    // mirror at the edges, moving by an even number of pixels keeps the color of the sample
+    ivec2 size = textureSize(rawTexture, 0);
+    p = abs(p);
+    p = min(p, 2*(size - 1) - p);
+
+    return texelFetch(rawTexture, p, 0).r;
+}
+
 void main()
 {
-    float r = texture(ourTexture, texCoord).r;
-    color = vec4(r, r, r, 1.0);
+    ivec2 p = ivec2(gl_FragCoord.xy);
+
+    float c = fetch(p);
+    float h1 = fetch(p + ivec2(-1, 0)) + fetch(p + ivec2(1, 0));
+    float v1 = fetch(p + ivec2(0, -1)) + fetch(p + ivec2(0, 1));
+    float d = fetch(p + ivec2(-1, -1)) + fetch(p + ivec2(1, -1)) + fetch(p + ivec2(-1, 1)) + fetch(p + ivec2(1, 1));
+
+#ifdef MALVAR
+    float h2 = fetch(p + ivec2(-2, 0)) + fetch(p + ivec2(2, 0));
+    float v2 = fetch(p + ivec2(0, -2)) + fetch(p + ivec2(0, 2));
+
+    // weights from the paper, in eighths
+    float cross = (4.0*c + 2.0*(h1 + v1) - (h2 + v2)) / 8.0;
+    float row = (5.0*c + 4.0*h1 - h2 + 0.5*v2 - d) / 8.0;
+    float column = (5.0*c + 4.0*v1 - v2 + 0.5*h2 - d) / 8.0;
+    float diagonal = (6.0*c + 2.0*d - 1.5*(h2 + v2)) / 8.0;
+#else
+    float cross = (h1 + v1) / 4.0;
+    float row = h1 / 2.0;
+    float column = v1 / 2.0;
+    float diagonal = d / 4.0;
+#endif
+
+    // cross is green on red or blue, row and column are the colors left/right and above/below
+    // a green sample, diagonal is blue on red and red on blue
+    ivec2 phase = (p + redOffset) & 1;
+    vec3 rgb;
+
+    if (phase == ivec2(0, 0)) {
+        rgb = vec3(c, cross, diagonal);
+    } else if (phase == ivec2(1, 1)) {
+        rgb = vec3(diagonal, cross, c);
+    } else if (phase == ivec2(1, 0)) {
+        rgb = vec3(row, c, column);
+    } else {
+        rgb = vec3(column, c, row);
+    }
+
+    color = vec4(clamp(rgb * levelScale + levelOffset, 0.0, 1.0), 1.0);
 }
-)###";
\ No newline at end of file
+)###";
@@ -0,0 +1,198 @@
+#include <glm/gtc/type_ptr.hpp>
+
+#include <stdexcept>
+#include <vector>
+
+#include "shader_program.hpp"
+#include "opengl_helper.hpp"
+
+template <> void Uniform<int>::set(const int &value) const { GL_CHECK(glUniform1i(location_, value)); }
+template <> void Uniform<bool>::set(const bool &value) const { GL_CHECK(glUniform1i(location_, value)); }
+template <> void Uniform<float>::set(const float &value) const { GL_CHECK(glUniform1f(location_, value)); }
+template <> void Uniform<glm::ivec2>::set(const glm::ivec2 &value) const { GL_CHECK(glUniform2i(location_, value.x, value.y)); }
+template <> void Uniform<glm::vec3>::set(const glm::vec3 &value) const { GL_CHECK(glUniform3fv(location_, 1, glm::value_ptr(value))); }
+template <> void Uniform<glm::vec4>::set(const glm::vec4 &value) const { GL_CHECK(glUniform4fv(location_, 1, glm::value_ptr(value))); }
+template <> void Uniform<glm::mat3>::set(const glm::mat3 &value) const { GL_CHECK(glUniformMatrix3fv(location_, 1, GL_FALSE, glm::value_ptr(value))); }
+template <> void Uniform<glm::mat4>::set(const glm::mat4 &value) const { GL_CHECK(glUniformMatrix4fv(location_, 1, GL_FALSE, glm::value_ptr(value))); }
+
+template <> GLenum ShaderProgram::glType<int>() { return GL_INT; }
+template <> GLenum ShaderProgram::glType<bool>() { return GL_BOOL; }
+template <> GLenum ShaderProgram::glType<float>() { return GL_FLOAT; }
+template <> GLenum ShaderProgram::glType<glm::ivec2>() { return GL_INT_VEC2; }
+template <> GLenum ShaderProgram::glType<glm::vec3>() { return GL_FLOAT_VEC3; }
+template <> GLenum ShaderProgram::glType<glm::vec4>() { return GL_FLOAT_VEC4; }
+template <> GLenum ShaderProgram::glType<glm::mat3>() { return GL_FLOAT_MAT3; }
+template <> GLenum ShaderProgram::glType<glm::mat4>() { return GL_FLOAT_MAT4; }
+
+// Arrays are reported as "name[0]"
+static std::string baseName(const char *name)
+{
+    std::string ret(name);
+    size_t pos = ret.find('[');
+
+    if (pos != std::string::npos) {
+        ret.resize(pos);
+    }
+
+    return ret;
+}
+
+static bool isSampler(GLenum type)
+{
+    switch (type) {
+        case GL_SAMPLER_2D:
+        case GL_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_2D:
+            return true;
+        default:
+            return false;
+    }
+}
+
+ShaderProgram::ShaderProgram(const std::string &vertex_shader_code, const std::string &fragment_shader_code)
+{
+    program_ = loadShaders(vertex_shader_code, fragment_shader_code);
+
+    GLint count = 0;
+    GLint max_length = 0;
+
+    // uniforms in the default block, the ones in named blocks have no location
+    GL_CHECK(glGetProgramiv(program_, GL_ACTIVE_UNIFORMS, &count));
+    GL_CHECK(glGetProgramiv(program_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length));
+
+    std::vector<char> name(max_length + 1);
+
+    for (GLint i = 0; i < count; i++) {
+        GLint size;
+        GLenum type;
+        GLint block_index;
+        GLuint index = i;
+
+        GL_CHECK(glGetActiveUniform(program_, index, name.size(), nullptr, &size, &type, name.data()));
+        GL_CHECK(glGetActiveUniformsiv(program_, 1, &index, GL_UNIFORM_BLOCK_INDEX, &block_index));
+
+        if (block_index != -1) {
+            continue;
+        }
+
+        ActiveUniform u;
+        u.location = glGetUniformLocation(program_, name.data());
+        u.type = type;
+
+        uniforms_[baseName(name.data())] = u;
+    }
+
+    GL_CHECK(glGetProgramiv(program_, GL_ACTIVE_UNIFORM_BLOCKS, &count));
+    GL_CHECK(glGetProgramiv(program_, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length));
+
+    name.resize(max_length + 1);
+
+    for (GLint i = 0; i < count; i++) {
+        GL_CHECK(glGetActiveUniformBlockName(program_, i, name.size(), nullptr, name.data()));
+        uniform_blocks_[name.data()] = i;
+    }
+
+    GL_CHECK(glGetProgramiv(program_, GL_ACTIVE_ATTRIBUTES, &count));
+    GL_CHECK(glGetProgramiv(program_, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length));
+
+    name.resize(max_length + 1);
+
+    for (GLint i = 0; i < count; i++) {
+        GLint size;
+        GLenum type;
+
+        GL_CHECK(glGetActiveAttrib(program_, i, name.size(), nullptr, &size, &type, name.data()));
+        attributes_[name.data()] = glGetAttribLocation(program_, name.data());
+    }
+}
+
+ShaderProgram::~ShaderProgram()
+{
+    glDeleteProgram(program_);
+}
+
+void ShaderProgram::use() const
+{
+    GL_CHECK(glUseProgram(program_));
+}
+
+bool ShaderProgram::hasUniform(const std::string &name) const
+{
+    return uniforms_.count(name) > 0;
+}
+
+bool ShaderProgram::hasUniformBlock(const std::string &name) const
+{
+    return uniform_blocks_.count(name) > 0;
+}
+
+GLint ShaderProgram::attribute(const std::string &name) const
+{
+    auto it = attributes_.find(name);
+
+    if (it == attributes_.end()) {
+        throw std::runtime_error("No active attribute " + name);
+    }
+
+    return it->second;
+}
+
+void ShaderProgram::bindUniformBlock(const std::string &name, GLuint binding) const
+{
+    auto it = uniform_blocks_.find(name);
+
+    if (it == uniform_blocks_.end()) {
+        throw std::runtime_error("No active uniform block " + name);
+    }
+
+    GL_CHECK(glUniformBlockBinding(program_, it->second, binding));
+}
+
+GLint ShaderProgram::lookup(const std::string &name, GLenum type) const
+{
+    auto it = uniforms_.find(name);
+
+    if (it == uniforms_.end()) {
+        throw std::runtime_error("No active uniform " + name);
+    }
+
+    // samplers are set with glUniform1i
+    bool match = it->second.type == type || (type == GL_INT && isSampler(it->second.type));
+
+    if (!match) {
+        throw std::runtime_error("Uniform " + name + " type mismatch");
+    }
+
+    return it->second.location;
+}
+
+UniformBuffer::UniformBuffer(GLuint binding, size_t size) :
+    binding_(binding),
+    size_(size)
+{
+    GL_CHECK(glGenBuffers(1, &buffer_));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, buffer_));
+    GL_CHECK(glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    glDeleteBuffers(1, &buffer_);
+}
+
+void UniformBuffer::update(const void *data, size_t size, size_t offset)
+{
+    if (offset + size > size_) {
+        throw std::runtime_error("UniformBuffer update out of range");
+    }
+
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, buffer_));
+    GL_CHECK(glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+}
+
+void UniformBuffer::bind() const
+{
+    GL_CHECK(glBindBufferBase(GL_UNIFORM_BUFFER, binding_, buffer_));
+}
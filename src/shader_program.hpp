@@ -0,0 +1,112 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <map>
+#include <string>
+
+// Location of an active uniform of GLSL type T. set() applies to the program currently in use.
+template <typename T>
+class Uniform
+{
+public:
+    Uniform() {}
+    explicit Uniform(GLint location) : location_(location) {}
+
+    void set(const T &value) const;
+
+    GLint location() const { return location_; }
+
+private:
+    GLint location_ = -1;
+};
+
+template <> void Uniform<int>::set(const int &value) const;
+template <> void Uniform<bool>::set(const bool &value) const;
+template <> void Uniform<float>::set(const float &value) const;
+template <> void Uniform<glm::ivec2>::set(const glm::ivec2 &value) const;
+template <> void Uniform<glm::vec3>::set(const glm::vec3 &value) const;
+template <> void Uniform<glm::vec4>::set(const glm::vec4 &value) const;
+template <> void Uniform<glm::mat3>::set(const glm::mat3 &value) const;
+template <> void Uniform<glm::mat4>::set(const glm::mat4 &value) const;
+
+// Linked program whose active uniforms, uniform blocks and attributes are introspected once
+// at link time, so there are no string lookups in the render loop.
+class ShaderProgram
+{
+public:
+    ShaderProgram(const std::string &vertex_shader_code, const std::string &fragment_shader_code);
+    ~ShaderProgram();
+
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    void use() const;
+    GLuint id() const { return program_; }
+
+    // Typed handle to an active uniform. Throws if the uniform doesn't exist or T doesn't match
+    // its GLSL type. Uniforms the compiler optimised away are reported as not existing.
+    template <typename T>
+    Uniform<T> uniform(const std::string &name) const
+    {
+        return Uniform<T>(lookup(name, glType<T>()));
+    }
+
+    bool hasUniform(const std::string &name) const;
+    bool hasUniformBlock(const std::string &name) const;
+    GLint attribute(const std::string &name) const;
+
+    // Assigns the named uniform block to a uniform buffer binding point
+    void bindUniformBlock(const std::string &name, GLuint binding) const;
+
+private:
+    struct ActiveUniform
+    {
+        GLint location;
+        GLenum type;
+    };
+
+    template <typename T>
+    static GLenum glType();
+
+    GLint lookup(const std::string &name, GLenum type) const;
+
+    GLuint program_ = 0;
+    std::map<std::string, ActiveUniform> uniforms_;
+    std::map<std::string, GLuint> uniform_blocks_;
+    std::map<std::string, GLint> attributes_;
+};
+
+template <> GLenum ShaderProgram::glType<int>();
+template <> GLenum ShaderProgram::glType<bool>();
+template <> GLenum ShaderProgram::glType<float>();
+template <> GLenum ShaderProgram::glType<glm::ivec2>();
+template <> GLenum ShaderProgram::glType<glm::vec3>();
+template <> GLenum ShaderProgram::glType<glm::vec4>();
+template <> GLenum ShaderProgram::glType<glm::mat3>();
+template <> GLenum ShaderProgram::glType<glm::mat4>();
+
+// Uniform buffer holding data shared by several programs, eg. the camera matrices.
+// Upload it when it changes and bind it once to its binding point.
+class UniformBuffer
+{
+public:
+    UniformBuffer(GLuint binding, size_t size);
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    void update(const void *data, size_t size, size_t offset = 0);
+    void bind() const;
+
+private:
+    GLuint binding_;
+    size_t size_;
+    GLuint buffer_ = 0;
+};
@@ -0,0 +1,195 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include "shm_frame_ring.hpp"
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared memory ring needs lock-free 64-bit atomics");
+
+static const char MAGIC[4] = {'F', 'R', 'N', 'G'};
+static const uint32_t VERSION = 1;
+
+static ShmSlotInfo *slotInfo(ShmRingHeader *header)
+{
+    return reinterpret_cast<ShmSlotInfo*>(header + 1);
+}
+
+static unsigned char *slotData(ShmRingHeader *header, uint64_t index)
+{
+    return reinterpret_cast<unsigned char*>(header) + header->slot_offset + (index % header->num_slots) * header->slot_size;
+}
+
+ShmFrameWriter::ShmFrameWriter(const std::string &name, int width, int height, PixelFormat format, int num_slots) :
+    name_(name)
+{
+    if (num_slots < 1) {
+        throw std::runtime_error("ShmFrameWriter needs at least one slot");
+    }
+
+    uint32_t stride = planeLayout(format, width, height)[0].stride;
+
+    // page align the payloads
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t slot_offset = (sizeof(ShmRingHeader) + num_slots*sizeof(ShmSlotInfo) + page - 1) / page * page;
+    size_t slot_size = (frameSize(format, width, height) + page - 1) / page * page;
+
+    size_ = slot_offset + slot_size*num_slots;
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+
+    if (fd < 0) {
+        throw std::runtime_error("shm_open failed for " + name);
+    }
+
+    if (ftruncate(fd, size_) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("ftruncate failed for " + name);
+    }
+
+    mapping_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping_ == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("mmap failed for " + name);
+    }
+
+    header_ = new (mapping_) ShmRingHeader();
+    header_->version = VERSION;
+    header_->width = width;
+    header_->height = height;
+    header_->format = static_cast<uint32_t>(format);
+    header_->stride = stride;
+    header_->num_slots = num_slots;
+    header_->slot_offset = slot_offset;
+    header_->slot_size = slot_size;
+    header_->write_index.store(0);
+    header_->read_index.store(0);
+
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header_->magic, MAGIC, sizeof(MAGIC));
+}
+
+ShmFrameWriter::~ShmFrameWriter()
+{
+    munmap(mapping_, size_);
+    shm_unlink(name_.c_str());
+}
+
+unsigned char *ShmFrameWriter::acquire()
+{
+    uint64_t write = header_->write_index.load(std::memory_order_relaxed);
+    uint64_t read = header_->read_index.load(std::memory_order_acquire);
+
+    if (write - read >= header_->num_slots) {
+        return nullptr;
+    }
+
+    return slotData(header_, write);
+}
+
+void ShmFrameWriter::publish(int64_t timestamp_ns)
+{
+    uint64_t write = header_->write_index.load(std::memory_order_relaxed);
+
+    ShmSlotInfo &info = slotInfo(header_)[write % header_->num_slots];
+    info.timestamp_ns = timestamp_ns;
+    info.sequence = sequence_++;
+
+    header_->write_index.store(write + 1, std::memory_order_release);
+}
+
+ShmFrameSource::ShmFrameSource(const std::string &name, int timeout_ms) :
+    timeout_ms_(timeout_ms)
+{
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+
+    if (fd < 0) {
+        throw std::runtime_error("shm_open failed for " + name + ", is the producer running?");
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ShmRingHeader)) {
+        close(fd);
+        throw std::runtime_error(name + " is not a frame ring");
+    }
+
+    size_ = st.st_size;
+    mapping_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping_ == MAP_FAILED) {
+        throw std::runtime_error("mmap failed for " + name);
+    }
+
+    header_ = static_cast<ShmRingHeader*>(mapping_);
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    bool valid = std::memcmp(header_->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+        header_->version == VERSION &&
+        header_->num_slots > 0 &&
+        header_->slot_offset + header_->slot_size * header_->num_slots <= size_;
+
+    try {
+        // throws on an unknown format or a bad size
+        valid = valid && frameSize(static_cast<PixelFormat>(header_->format), header_->width, header_->height, header_->stride) <= header_->slot_size;
+    } catch (const std::runtime_error &e) {
+        valid = false;
+    }
+
+    if (!valid) {
+        munmap(mapping_, size_);
+        throw std::runtime_error(name + " is not a version 1 frame ring");
+    }
+
+    // start from whatever the producer has published but we haven't consumed
+    next_ = header_->read_index.load(std::memory_order_acquire);
+}
+
+ShmFrameSource::~ShmFrameSource()
+{
+    munmap(mapping_, size_);
+}
+
+AcquireResult ShmFrameSource::acquire(Frame &frame)
+{
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms_);
+
+    // nothing to block on across processes, poll
+    while (header_->write_index.load(std::memory_order_acquire) <= next_) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return AcquireResult::Timeout;
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    const ShmSlotInfo &info = slotInfo(header_)[next_ % header_->num_slots];
+
+    frame.data = slotData(header_, next_);
+    frame.width = header_->width;
+    frame.height = header_->height;
+    frame.format = static_cast<PixelFormat>(header_->format);
+    frame.stride = header_->stride;
+    frame.timestamp_ns = info.timestamp_ns;
+    frame.sequence = info.sequence;
+    frame.handle = next_;
+
+    next_++;
+
+    return AcquireResult::Acquired;
+}
+
+void ShmFrameSource::release(const Frame &frame)
+{
+    header_->read_index.store(frame.handle + 1, std::memory_order_release);
+}
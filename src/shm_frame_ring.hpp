@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "frame_source.hpp"
+
+// Single-producer single-consumer frame ring in POSIX shared memory, for a capture process to
+// hand frames over without a socket or a copy. The producer (ShmFrameWriter) writes straight into
+// a free slot and publishes it, the consumer (ShmFrameSource) reads it in place and releases it.
+// When all slots are in use the producer drops frames instead of waiting.
+//
+// Layout, everything in one shm object:
+//   ShmRingHeader
+//   ShmSlotInfo[num_slots]
+//   payload[num_slots], each slot_size bytes starting at slot_offset
+struct ShmRingHeader
+{
+    char magic[4]; // "FRNG", written last by the producer
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format; // PixelFormat
+    uint32_t stride;
+    uint32_t num_slots;
+    uint32_t slot_offset;
+    uint64_t slot_size;
+
+    // frames published by the producer and released by the consumer, slot = index % num_slots
+    alignas(64) std::atomic<uint64_t> write_index;
+    alignas(64) std::atomic<uint64_t> read_index;
+};
+
+struct ShmSlotInfo
+{
+    int64_t timestamp_ns;
+    uint64_t sequence;
+};
+
+// Producer side, creates the shm object and removes it again on destruction
+class ShmFrameWriter
+{
+public:
+    ShmFrameWriter(const std::string &name, int width, int height, PixelFormat format, int num_slots = 4);
+    ~ShmFrameWriter();
+
+    ShmFrameWriter(const ShmFrameWriter&) = delete;
+    ShmFrameWriter& operator=(const ShmFrameWriter&) = delete;
+
+    // Slot to write the next frame into, nullptr if the consumer hasn't released any (drop the frame)
+    unsigned char *acquire();
+
+    // Make the frame written since acquire() visible to the consumer
+    void publish(int64_t timestamp_ns);
+
+    int stride() const { return header_->stride; }
+
+private:
+    std::string name_;
+    void *mapping_ = nullptr;
+    size_t size_ = 0;
+    ShmRingHeader *header_ = nullptr;
+    uint64_t sequence_ = 0;
+};
+
+// Consumer side, frames are borrowed straight out of shared memory
+class ShmFrameSource : public FrameSource
+{
+public:
+    // acquire() returns AcquireResult::Timeout after timeout_ms without a new frame, the ring
+    // never ends
+    explicit ShmFrameSource(const std::string &name, int timeout_ms = 1000);
+    ~ShmFrameSource();
+
+    int width() const { return header_->width; }
+    int height() const { return header_->height; }
+    PixelFormat format() const { return static_cast<PixelFormat>(header_->format); }
+
+    AcquireResult acquire(Frame &frame);
+    void release(const Frame &frame);
+    size_t maxBorrowed() const { return header_->num_slots; }
+
+private:
+    void *mapping_ = nullptr;
+    size_t size_ = 0;
+    ShmRingHeader *header_ = nullptr;
+    int timeout_ms_;
+
+    // next frame to hand out, ahead of read_index by the number of borrowed frames
+    uint64_t next_ = 0;
+};
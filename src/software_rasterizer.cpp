@@ -0,0 +1,453 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "software_rasterizer.hpp"
+
+static constexpr int tile_size = 64;
+
+SoftwareRasterizer::SoftwareRasterizer(int image_width, int image_height, const Mesh &mesh) :
+    image_width_(image_width),
+    image_height_(image_height),
+    mesh_(mesh),
+    camera_(image_width, image_height, 1, 1, 0, 0)
+{
+}
+
+void SoftwareRasterizer::setCamera(const CameraModel &camera)
+{
+    if (camera.width() == image_width_ && camera.height() == image_height_) {
+        camera_ = camera;
+    } else {
+        camera_ = camera.scaled(image_width_, image_height_);
+    }
+}
+
+void SoftwareRasterizer::setDepthRange(float near_plane, float far_plane, DepthMode mode)
+{
+    near_plane_ = near_plane;
+    far_plane_ = far_plane;
+    depth_mode_ = mode;
+}
+
+void SoftwareRasterizer::setupTriangles(const glm::mat4 &model, int viewport_width, int viewport_height)
+{
+    glm::mat4 transform = camera_.projection(viewport_width, viewport_height, near_plane_, far_plane_, depth_mode_) * model;
+
+    size_t count = mesh_.vertices.size() / 3;
+    clip_.resize(count);
+
+    for (size_t i = 0; i < count; i++) {
+        clip_[i] = transform * glm::vec4(mesh_.vertices[i*3], mesh_.vertices[i*3 + 1], mesh_.vertices[i*3 + 2], 1.0f);
+    }
+
+    // signed distance to the near plane in clip space, -w <= z or z <= w for ReversedZ
+    auto nearDistance = [&](const glm::vec4 &p) {
+        return depth_mode_ == DepthMode::ReversedZ ? p.w - p.z : p.z + p.w;
+    };
+
+    triangles_.clear();
+
+    for (size_t i = 0; i + 2 < mesh_.indices.size(); i += 3) {
+        ClipVertex in[3];
+
+        for (int k = 0; k < 3; k++) {
+            uint32_t index = mesh_.indices[i + k];
+            in[k].position = clip_[index];
+
+            for (int c = 0; c < 4; c++) {
+                in[k].color[c] = mesh_.colors[index*4 + c];
+            }
+        }
+
+        // one plane turns the triangle into at most a quad
+        ClipVertex out[4];
+        int num_out = 0;
+
+        for (int k = 0; k < 3; k++) {
+            const ClipVertex &a = in[k];
+            const ClipVertex &b = in[(k + 1) % 3];
+            float da = nearDistance(a.position);
+            float db = nearDistance(b.position);
+
+            if (da >= 0) {
+                out[num_out++] = a;
+            }
+
+            if ((da >= 0) != (db >= 0)) {
+                float t = da / (da - db);
+                ClipVertex &v = out[num_out++];
+
+                v.position = a.position + (b.position - a.position) * t;
+
+                for (int c = 0; c < 4; c++) {
+                    v.color[c] = a.color[c] + (b.color[c] - a.color[c]) * t;
+                }
+            }
+        }
+
+        for (int k = 1; k + 1 < num_out; k++) {
+            const ClipVertex *fan[3] = {&out[0], &out[k], &out[k + 1]};
+            addTriangle(fan, viewport_width, viewport_height);
+        }
+    }
+}
+
+void SoftwareRasterizer::addTriangle(const ClipVertex *vertices[3], int viewport_width, int viewport_height)
+{
+    float px[3], py[3], pz[3], inverse_w[3];
+    bool finite = true;
+
+    for (int k = 0; k < 3; k++) {
+        const glm::vec4 &p = vertices[k]->position;
+
+        // viewport transform, y down so rows go from the top like the output image
+        inverse_w[k] = 1.0f / p.w;
+        px[k] = (p.x * inverse_w[k] + 1) * 0.5f * viewport_width;
+        py[k] = (1 - p.y * inverse_w[k]) * 0.5f * viewport_height;
+        pz[k] = depth_mode_ == DepthMode::ReversedZ ? p.z * inverse_w[k] : p.z * inverse_w[k] * 0.5f + 0.5f;
+        finite = finite && std::isfinite(px[k]) && std::isfinite(py[k]) && std::isfinite(pz[k]);
+    }
+
+    double area = (double(px[1]) - px[0])*(double(py[2]) - py[0]) - (double(px[2]) - px[0])*(double(py[1]) - py[0]);
+
+    if (!finite || area == 0) {
+        return;
+    }
+
+    // no face culling, flip the edges of clockwise triangles so inside is positive
+    double sign = area > 0 ? 1 : -1;
+    Triangle triangle;
+
+    // edge k is opposite vertex k and equals the doubled area at it, so edge k / area is the
+    // barycentric weight of vertex k
+    for (int k = 0; k < 3; k++) {
+        int a = (k + 1) % 3;
+        int b = (k + 2) % 3;
+
+        double dx = -(double(py[b]) - py[a]) * sign;
+        double dy = (double(px[b]) - px[a]) * sign;
+
+        triangle.edges[k].dx = dx;
+        triangle.edges[k].dy = dy;
+        triangle.edges[k].c = -(dx*px[a] + dy*py[a]);
+
+        // with y down, left edges have inside to the right and top edges inside below
+        triangle.inclusive[k] = dx > 0 || (dx == 0 && dy > 0);
+    }
+
+    auto attributePlane = [&](const float values[3]) {
+        Plane plane = {0, 0, 0};
+
+        for (int k = 0; k < 3; k++) {
+            double weight = values[k] / std::fabs(area);
+            plane.c += triangle.edges[k].c * weight;
+            plane.dx += triangle.edges[k].dx * weight;
+            plane.dy += triangle.edges[k].dy * weight;
+        }
+
+        return plane;
+    };
+
+    // window depth is linear in screen space, attributes only once divided by w
+    triangle.depth = attributePlane(pz);
+    triangle.inverse_w = attributePlane(inverse_w);
+
+    for (int c = 0; c < 4; c++) {
+        float values[3];
+
+        for (int k = 0; k < 3; k++) {
+            values[k] = vertices[k]->color[c] * inverse_w[k];
+        }
+
+        triangle.color[c] = attributePlane(values);
+    }
+
+    // pixels whose center is inside the bounding box
+    float min_x = std::min({px[0], px[1], px[2]});
+    float max_x = std::max({px[0], px[1], px[2]});
+    float min_y = std::min({py[0], py[1], py[2]});
+    float max_y = std::max({py[0], py[1], py[2]});
+
+    triangle.min_x = std::max(0.0f, std::ceil(min_x - 0.5f));
+    triangle.min_y = std::max(0.0f, std::ceil(min_y - 0.5f));
+    triangle.max_x = std::min(viewport_width - 1.0f, std::floor(max_x - 0.5f));
+    triangle.max_y = std::min(viewport_height - 1.0f, std::floor(max_y - 0.5f));
+
+    if (triangle.min_x <= triangle.max_x && triangle.min_y <= triangle.max_y) {
+        triangles_.push_back(triangle);
+    }
+}
+
+void SoftwareRasterizer::setupColumns(int viewport_width, int gray_width)
+{
+    int width = std::min(viewport_width, image_width_);
+
+    columns_.resize(width);
+
+    for (int x = 0; x < width; x++) {
+        // texel position of the pixel center, texel centers are at + 0.5
+        float s = (x + 0.5f) / image_width_ * gray_width - 0.5f;
+        int col = std::floor(s);
+
+        columns_[x].col0 = std::min(std::max(col, 0), gray_width - 1);
+        columns_[x].col1 = std::min(std::max(col + 1, 0), gray_width - 1);
+        columns_[x].weight = s - col;
+    }
+}
+
+void SoftwareRasterizer::drawBackground(int x0, int y0, int x1, int y1, const unsigned char *gray, int gray_width, int gray_height)
+{
+    int image_x1 = std::min(x1, static_cast<int>(columns_.size()));
+
+    // the far end of the depth range
+    float clear_depth = depth_mode_ == DepthMode::ReversedZ ? 0.0f : 1.0f;
+
+    for (int y = y0; y < y1; y++) {
+        float *row_color[4];
+
+        for (int c = 0; c < 4; c++) {
+            row_color[c] = &color_[c][y*stride_];
+        }
+
+        std::fill(&depth_buffer_[y*stride_ + x0], &depth_buffer_[y*stride_ + x1], clear_depth);
+
+        // outside the image is the clear color
+        int x = x0;
+
+        if (y < image_height_) {
+            float t = (y + 0.5f) / image_height_ * gray_height - 0.5f;
+            int row = std::floor(t);
+            float fy = t - row;
+            const unsigned char *row0 = gray + std::min(std::max(row, 0), gray_height - 1) * gray_width;
+            const unsigned char *row1 = gray + std::min(std::max(row + 1, 0), gray_height - 1) * gray_width;
+
+            for (; x < image_x1; x++) {
+                const Column &column = columns_[x];
+
+                float top = row0[column.col0] + (row0[column.col1] - row0[column.col0]) * column.weight;
+                float bottom = row1[column.col0] + (row1[column.col1] - row1[column.col0]) * column.weight;
+                float value = std::floor(top + (bottom - top) * fy + 0.5f);
+
+                row_color[0][x] = value;
+                row_color[1][x] = value;
+                row_color[2][x] = value;
+                row_color[3][x] = 255;
+            }
+        }
+
+        for (int c = 0; c < 4; c++) {
+            std::fill(row_color[c] + x, row_color[c] + x1, 0.0f);
+        }
+    }
+}
+
+void SoftwareRasterizer::drawTriangle(const Triangle &triangle, int x0, int y0, int x1, int y1)
+{
+    // whole groups of 4, tiles start on a multiple of 4
+    int start_x = std::max(triangle.min_x, x0) & ~3;
+    int end_x = std::min(triangle.max_x + 1, x1);
+    int start_y = std::max(triangle.min_y, y0);
+    int end_y = std::min(triangle.max_y + 1, y1);
+
+    const bool reversed = depth_mode_ == DepthMode::ReversedZ;
+
+    for (int y = start_y; y < end_y; y++) {
+        // row start in double, the per pixel steps are small enough for float
+        double px = start_x + 0.5;
+        double py = y + 0.5;
+
+        float edge[3], depth, inverse_w, color[4];
+        float step[3], depth_step, inverse_w_step, color_step[4];
+
+        for (int k = 0; k < 3; k++) {
+            edge[k] = triangle.edges[k].c + triangle.edges[k].dx*px + triangle.edges[k].dy*py;
+            step[k] = triangle.edges[k].dx;
+        }
+
+        depth = triangle.depth.c + triangle.depth.dx*px + triangle.depth.dy*py;
+        depth_step = triangle.depth.dx;
+
+        inverse_w = triangle.inverse_w.c + triangle.inverse_w.dx*px + triangle.inverse_w.dy*py;
+        inverse_w_step = triangle.inverse_w.dx;
+
+        for (int c = 0; c < 4; c++) {
+            color[c] = triangle.color[c].c + triangle.color[c].dx*px + triangle.color[c].dy*py;
+            color_step[c] = triangle.color[c].dx;
+        }
+
+        float *row_depth = &depth_buffer_[y*stride_];
+        float *row_color[4];
+
+        for (int c = 0; c < 4; c++) {
+            row_color[c] = &color_[c][y*stride_];
+        }
+
+#ifdef __SSE2__
+        const __m128 lane = _mm_set_ps(3, 2, 1, 0);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1);
+        const __m128 scale = _mm_set1_ps(255);
+
+        for (int x = start_x; x < end_x; x += 4) {
+            __m128 offset = _mm_add_ps(_mm_set1_ps(x - start_x), lane);
+
+            // lanes past the end of the tile or triangle bounds
+            __m128 mask = _mm_cmplt_ps(_mm_add_ps(_mm_set1_ps(x), lane), _mm_set1_ps(end_x));
+
+            for (int k = 0; k < 3; k++) {
+                __m128 e = _mm_add_ps(_mm_set1_ps(edge[k]), _mm_mul_ps(_mm_set1_ps(step[k]), offset));
+                __m128 inside = triangle.inclusive[k] ? _mm_cmpge_ps(e, zero) : _mm_cmpgt_ps(e, zero);
+                mask = _mm_and_ps(mask, inside);
+            }
+
+            if (_mm_movemask_ps(mask) == 0) {
+                continue;
+            }
+
+            // beyond the far plane, then the depth test
+            __m128 z = _mm_add_ps(_mm_set1_ps(depth), _mm_mul_ps(_mm_set1_ps(depth_step), offset));
+            __m128 stored = _mm_loadu_ps(row_depth + x);
+            mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(z, zero), _mm_cmple_ps(z, one)));
+            mask = _mm_and_ps(mask, reversed ? _mm_cmpgt_ps(z, stored) : _mm_cmplt_ps(z, stored));
+
+            if (_mm_movemask_ps(mask) == 0) {
+                continue;
+            }
+
+            _mm_storeu_ps(row_depth + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, stored)));
+
+            __m128 w = _mm_div_ps(one, _mm_add_ps(_mm_set1_ps(inverse_w), _mm_mul_ps(_mm_set1_ps(inverse_w_step), offset)));
+            __m128 src[4];
+
+            for (int c = 0; c < 4; c++) {
+                src[c] = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(color[c]), _mm_mul_ps(_mm_set1_ps(color_step[c]), offset)), w);
+            }
+
+            __m128 alpha = src[3];
+            __m128 inverse = _mm_sub_ps(one, alpha);
+
+            for (int c = 0; c < 4; c++) {
+                __m128 dst = _mm_loadu_ps(row_color[c] + x);
+
+                // src * alpha + dst * (1 - alpha), rounded to 8 bits like the framebuffer
+                __m128 blended = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(src[c], scale), alpha), _mm_mul_ps(dst, inverse));
+                blended = _mm_cvtepi32_ps(_mm_cvtps_epi32(blended));
+
+                _mm_storeu_ps(row_color[c] + x, _mm_or_ps(_mm_and_ps(mask, blended), _mm_andnot_ps(mask, dst)));
+            }
+        }
+#else
+        for (int x = start_x; x < end_x; x++) {
+            float offset = x - start_x;
+            bool inside = true;
+
+            for (int k = 0; k < 3; k++) {
+                float e = edge[k] + step[k] * offset;
+                inside = inside && (triangle.inclusive[k] ? e >= 0 : e > 0);
+            }
+
+            float z = depth + depth_step * offset;
+            bool passed = reversed ? z > row_depth[x] : z < row_depth[x];
+
+            if (!inside || z < 0 || z > 1 || !passed) {
+                continue;
+            }
+
+            row_depth[x] = z;
+
+            float w = 1 / (inverse_w + inverse_w_step * offset);
+            float src[4];
+
+            for (int c = 0; c < 4; c++) {
+                src[c] = (color[c] + color_step[c] * offset) * w;
+            }
+
+            for (int c = 0; c < 4; c++) {
+                row_color[c][x] = std::nearbyint(src[c] * 255 * src[3] + row_color[c][x] * (1 - src[3]));
+            }
+        }
+#endif
+    }
+}
+
+void SoftwareRasterizer::shadeTile(int tile_x, int tile_y, const unsigned char *gray, int gray_width, int gray_height,
+    int viewport_width, int viewport_height, Image &out)
+{
+    int x0 = tile_x * tile_size;
+    int y0 = tile_y * tile_size;
+    int x1 = std::min(x0 + tile_size, viewport_width);
+    int y1 = std::min(y0 + tile_size, viewport_height);
+
+    drawBackground(x0, y0, x1, y1, gray, gray_width, gray_height);
+
+    for (const Triangle &triangle : triangles_) {
+        if (triangle.max_x >= x0 && triangle.min_x < x1 && triangle.max_y >= y0 && triangle.min_y < y1) {
+            drawTriangle(triangle, x0, y0, x1, y1);
+        }
+    }
+
+    for (int y = y0; y < y1; y++) {
+        unsigned char *dst = &out.data[(static_cast<size_t>(y) * viewport_width + x0) * 4];
+
+        for (int x = x0; x < x1; x++) {
+            for (int c = 0; c < 4; c++) {
+                *dst++ = static_cast<unsigned char>(color_[c][y*stride_ + x]);
+            }
+        }
+    }
+}
+
+void SoftwareRasterizer::draw(const unsigned char *gray, int gray_width, int gray_height, const glm::mat4 &model,
+    int viewport_width, int viewport_height, Image &out)
+{
+    stride_ = (viewport_width + 3) & ~3;
+    size_t size = static_cast<size_t>(stride_) * viewport_height;
+
+    for (int c = 0; c < 4; c++) {
+        color_[c].resize(size);
+    }
+
+    depth_buffer_.resize(size);
+
+    out.width = viewport_width;
+    out.height = viewport_height;
+    out.channels = 4;
+    out.data.resize(static_cast<size_t>(viewport_width) * viewport_height * 4);
+
+    setupTriangles(model, viewport_width, viewport_height);
+    setupColumns(viewport_width, gray_width);
+
+    int tiles_x = (viewport_width + tile_size - 1) / tile_size;
+    int tiles_y = (viewport_height + tile_size - 1) / tile_size;
+    int num_tiles = tiles_x * tiles_y;
+
+    // tiles are handed out in order, each thread takes the next one when it's done
+    std::atomic<int> next_tile(0);
+
+    auto worker = [&]() {
+        for (int tile = next_tile++; tile < num_tiles; tile = next_tile++) {
+            shadeTile(tile % tiles_x, tile / tiles_x, gray, gray_width, gray_height, viewport_width, viewport_height, out);
+        }
+    };
+
+    unsigned num_threads = num_threads_ ? num_threads_ : std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min<unsigned>(num_threads, num_tiles);
+
+    std::vector<std::thread> threads;
+
+    for (unsigned i = 1; i < num_threads; i++) {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
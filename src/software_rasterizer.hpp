@@ -0,0 +1,110 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <vector>
+
+#include "camera_model.hpp"
+#include "camera_projection.hpp"
+#include "image_io.hpp"
+#include "mesh.hpp"
+
+// CPU reference for what OverlayRenderer draws from a grayscale image with DistortionMode::None,
+// for machines without a GPU and as a golden image for the GL path. It follows the same pipeline:
+// - the image is stretched over the image_width x image_height rectangle with bilinear filtering,
+//   the rest of the viewport is cleared to transparent black
+// - the mesh vertices go through the same perspectiveFromIntrinsics() matrix, triangles are
+//   clipped against the near plane and fragments beyond the far plane are dropped, colors are
+//   interpolated perspective-correct and window depth linearly in screen space
+// - triangles are drawn in index order, depth tested with GL_LESS (GL_GREATER for ReversedZ)
+//   and blended with GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA into 8-bit RGBA
+// Pixels whose center lies exactly on an edge can go the other way than on the GPU, and blending
+// can round differently by one.
+//
+// The viewport is split into tiles shaded on separate threads. Coverage uses edge functions,
+// 4 pixels at a time with SSE2.
+class SoftwareRasterizer
+{
+public:
+    SoftwareRasterizer(int image_width, int image_height, const Mesh &mesh);
+
+    // See OverlayRenderer::setCamera(), the distortion is not used
+    void setCamera(const CameraModel &camera);
+
+    // See OverlayRenderer::setDepthRange()
+    void setDepthRange(float near_plane, float far_plane, DepthMode mode = DepthMode::Standard);
+
+    // 0 for one per core
+    void setNumThreads(unsigned num_threads) { num_threads_ = num_threads; }
+
+    // gray is an 8-bit gray_width x gray_height image, rows top to bottom. out is resized to
+    // RGBA, rows top to bottom.
+    void draw(const unsigned char *gray, int gray_width, int gray_height, const glm::mat4 &model,
+        int viewport_width, int viewport_height, Image &out);
+
+private:
+    // Screen space plane of an attribute, value = c + dx*x + dy*y. Double since c grows with the
+    // square of the coordinates, the steps along a row are fine in float.
+    struct Plane
+    {
+        double c;
+        double dx;
+        double dy;
+    };
+
+    struct Triangle
+    {
+        Plane edges[3]; // positive inside
+        bool inclusive[3]; // whether pixels exactly on the edge are inside, top-left rule
+        Plane depth;
+        Plane inverse_w; // 1/w and color/w for perspective-correct colors
+        Plane color[4];
+        int min_x, min_y, max_x, max_y; // pixel bounds, inclusive
+    };
+
+    // Vertex in clip space while clipping against the near plane
+    struct ClipVertex
+    {
+        glm::vec4 position;
+        float color[4];
+    };
+
+    // Bilinear taps of the background, the same for every row
+    struct Column
+    {
+        int col0;
+        int col1;
+        float weight;
+    };
+
+    void setupTriangles(const glm::mat4 &model, int viewport_width, int viewport_height);
+    void addTriangle(const ClipVertex *vertices[3], int viewport_width, int viewport_height);
+    void setupColumns(int viewport_width, int gray_width);
+    void shadeTile(int tile_x, int tile_y, const unsigned char *gray, int gray_width, int gray_height,
+        int viewport_width, int viewport_height, Image &out);
+    void drawBackground(int x0, int y0, int x1, int y1, const unsigned char *gray, int gray_width, int gray_height);
+    void drawTriangle(const Triangle &triangle, int x0, int y0, int x1, int y1);
+
+    int image_width_;
+    int image_height_;
+    Mesh mesh_;
+
+    CameraModel camera_;
+
+    float near_plane_ = 0.01f;
+    float far_plane_ = 10.0f;
+    DepthMode depth_mode_ = DepthMode::Standard;
+
+    unsigned num_threads_ = 0;
+
+    std::vector<glm::vec4> clip_; // mesh vertices in clip space
+    std::vector<Triangle> triangles_;
+    std::vector<Column> columns_;
+
+    // viewport sized planes, colors hold 8-bit values like the GL framebuffer. stride_ is a
+    // multiple of 4 so a row can always be processed 4 pixels at a time.
+    int stride_ = 0;
+    std::vector<float> color_[4];
+    std::vector<float> depth_buffer_;
+};
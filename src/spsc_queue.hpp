@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free single-producer single-consumer ring. Exactly one thread may push and
+// exactly one other thread may pop. Neither side ever blocks, a full or empty queue is
+// reported to the caller, who decides whether to wait, retry or drop.
+template <typename T>
+class SpscQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity)
+    {
+        size_t size = 1;
+
+        while (size < capacity) {
+            size *= 2;
+        }
+
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only. Returns false if the queue is full.
+    bool tryPush(T item)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+
+            if (tail - cached_head_ > mask_) {
+                return false;
+            }
+        }
+
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Consumer only. Returns false if the queue is empty.
+    bool tryPop(T &item)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+
+            if (head == cached_tail_) {
+                return false;
+            }
+        }
+
+        item = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Approximate when called while the other side is running
+    size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_;
+
+    // Producer and consumer each own a cache line so they don't invalidate each other's.
+    // The cached copy of the other side's index saves an atomic load per operation.
+    char pad0_[64];
+    std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+    char pad1_[64];
+    std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+    char pad2_[64];
+};
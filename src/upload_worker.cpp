@@ -0,0 +1,238 @@
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+#include "upload_worker.hpp"
+#include "opengl_helper.hpp"
+
+UploadWorker::UploadWorker(RenderContext &context, CaptureThread &capture, int num_textures) :
+    capture_(capture),
+    shared_context_(context.createSharedContext()),
+    width_(capture.width()),
+    height_(capture.height()),
+    format_(capture.format()),
+    frame_size_(frameSize(format_, width_, height_)),
+    free_(num_textures),
+    ready_(num_textures)
+{
+    if (num_textures < 3) {
+        throw std::runtime_error("UploadWorker needs at least 3 textures");
+    }
+
+    // everything is created here and shared, the worker context only fills it
+    for (int i = 0; i < num_textures; i++) {
+        textures_.emplace_back(new FrameTextures(width_, height_, format_));
+
+        GLuint pbo;
+        GL_CHECK(glGenBuffers(1, &pbo));
+        GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo));
+        GL_CHECK(glBufferData(GL_PIXEL_UNPACK_BUFFER, frame_size_, nullptr, GL_STREAM_DRAW));
+        GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+        pbos_.push_back(pbo);
+
+        Slot slot;
+        slot.index = i;
+        free_.tryPush(slot);
+    }
+
+    blank_.reset(new FrameTextures(width_, height_, format_));
+
+    // the worker's context can only see objects that exist once they've reached the driver
+    GL_CHECK(glFinish());
+
+    thread_ = std::thread(&UploadWorker::run, this);
+}
+
+UploadWorker::~UploadWorker()
+{
+    stop_ = true;
+    thread_.join();
+
+    // the worker is gone, so everything is owned by this thread again
+    Slot slot;
+
+    while (free_.tryPop(slot)) {
+        glDeleteSync(slot.fence);
+    }
+
+    while (ready_.tryPop(slot)) {
+        glDeleteSync(slot.fence);
+    }
+
+    for (Slot &pending : pending_) {
+        glDeleteSync(pending.fence);
+    }
+
+    glDeleteSync(current_.fence);
+    glDeleteSync(leftover_.fence);
+    glDeleteBuffers(pbos_.size(), pbos_.data());
+}
+
+// The slot's PBO mapped for writing a whole frame, on the worker's context
+static unsigned char *mapPbo(GLuint pbo, size_t size)
+{
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo));
+
+    unsigned char *ptr = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+
+    if (!ptr) {
+        throw std::runtime_error("glMapBufferRange failed in the upload worker");
+    }
+
+    return ptr;
+}
+
+void UploadWorker::run()
+{
+    Slot slot;
+    Frame frame;
+    bool borrowed = false;
+
+    // with CaptureThread::fillsInPlace() the slot's PBO is lent to the capture, mapped, until
+    // the frame in it comes back from next()
+    bool lent = false;
+
+    try {
+        shared_context_->makeCurrent();
+
+        while (!stop_) {
+            // a texture to write into first, so the frame taken next is as fresh as possible
+            if (slot.index < 0 && !free_.tryPop(slot)) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+
+            if (capture_.fillsInPlace() && !lent) {
+                lent = capture_.provide(mapPbo(pbos_[slot.index], frame_size_));
+                GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+            }
+
+            if (!capture_.next(frame)) {
+                if (capture_.finished()) {
+                    break;
+                }
+
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+
+            borrowed = true;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            // the render thread may still be reading the texture, wait for it on the GPU
+            if (slot.fence) {
+                GL_CHECK(glWaitSync(slot.fence, 0, GL_TIMEOUT_IGNORED));
+                GL_CHECK(glDeleteSync(slot.fence));
+                slot.fence = 0;
+            }
+
+            if (lent) {
+                // already in the PBO
+                GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos_[slot.index]));
+                lent = false;
+            } else {
+                unsigned char *ptr = mapPbo(pbos_[slot.index], frame_size_);
+                copyFrame(ptr, frame.data, format_, width_, height_, frame.stride);
+            }
+
+            GL_CHECK(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+            capture_.release(frame);
+            borrowed = false;
+
+            textures_[slot.index]->update(0);
+            GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+            // the fence only signals if it reaches the GPU, another context can't flush it for us
+            slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            GL_CHECK(glFlush());
+
+            slot.sequence = frame.sequence;
+
+            // can't fail, there are only as many slots as the queue holds
+            ready_.tryPush(slot);
+            slot = Slot();
+
+            uploads_.fetch_add(1, std::memory_order_relaxed);
+            upload_ns_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(),
+                std::memory_order_relaxed);
+        }
+
+        shared_context_->doneCurrent();
+    } catch (const std::exception &e) {
+        std::cerr << "Upload worker stopped: " << e.what() << "\n";
+        shared_context_->doneCurrent();
+    }
+
+    if (borrowed) {
+        capture_.release(frame);
+    }
+
+    // the capture may still be writing into the lent PBO, it's unmapped when the destructor
+    // deletes it. The worker is the only consumer, nothing else needs the capture anymore.
+    if (lent) {
+        capture_.stop();
+    }
+
+    // free_ only takes pushes from the render thread, the destructor deletes the fence after join()
+    leftover_ = slot;
+
+    ended_ = true;
+}
+
+void UploadWorker::retire(Slot &slot)
+{
+    GL_CHECK(glDeleteSync(slot.fence));
+
+    // covers every draw so far that might have sampled the texture
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    free_.tryPush(slot);
+}
+
+const FrameTextures &UploadWorker::textures()
+{
+    Slot slot;
+
+    while (ready_.tryPop(slot)) {
+        pending_.push_back(slot);
+    }
+
+    // newest upload the GPU has finished, everything older goes back to the worker unseen
+    for (size_t i = pending_.size(); i-- > 0;) {
+        GLenum status = glClientWaitSync(pending_[i].fence, 0, 0);
+
+        if (status == GL_WAIT_FAILED) {
+            throw std::runtime_error("glClientWaitSync failed on an uploaded texture");
+        }
+
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+            if (current_.index >= 0) {
+                retire(current_);
+            }
+
+            for (size_t j = 0; j < i; j++) {
+                retire(pending_[j]);
+            }
+
+            current_ = pending_[i];
+            pending_.erase(pending_.begin(), pending_.begin() + i + 1);
+
+            // the worker waits on our fences, they have to reach the GPU
+            GL_CHECK(glFlush());
+            break;
+        }
+    }
+
+    return current_.index >= 0 ? *textures_[current_.index] : *blank_;
+}
+
+bool UploadWorker::finished() const
+{
+    return ended_ && ready_.size() == 0 && pending_.empty();
+}
+
+double UploadWorker::uploadMs() const
+{
+    uint64_t uploads = uploads_.load(std::memory_order_relaxed);
+    return uploads ? upload_ns_.load(std::memory_order_relaxed) / 1e6 / uploads : 0;
+}
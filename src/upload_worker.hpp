@@ -0,0 +1,91 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "capture_thread.hpp"
+#include "frame_textures.hpp"
+#include "render_context.hpp"
+#include "spsc_queue.hpp"
+
+// Uploads frames from a CaptureThread on a worker thread with its own GL context, sharing a pool
+// of FrameTextures with the render context. The render thread never touches pixel data, it only
+// picks up finished textures.
+//
+// Textures are handed over in both directions with a fence: the worker fences each upload and
+// the render thread only samples a texture once its fence has signalled, and the render thread
+// fences each texture it's done with and the worker waits for that on the GPU before
+// overwriting it.
+class UploadWorker
+{
+public:
+    // Call on the render thread with its context current. num_textures is at least 3: one on
+    // screen, one finished and waiting, one being written.
+    UploadWorker(RenderContext &context, CaptureThread &capture, int num_textures = 3);
+
+    // Render thread, stops the worker first
+    ~UploadWorker();
+
+    UploadWorker(const UploadWorker&) = delete;
+    UploadWorker& operator=(const UploadWorker&) = delete;
+
+    // Render thread, once per frame before drawing. The newest fully uploaded frame, black
+    // until the first frame has arrived. Never blocks.
+    const FrameTextures &textures();
+
+    // Sequence number of the frame in textures()
+    uint64_t sequence() const { return current_.sequence; }
+
+    // The capture ended and the last frame is on screen
+    bool finished() const;
+
+    // Average time the worker spent per upload, from the copy to the fence, over all frames
+    double uploadMs() const;
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    PixelFormat format() const { return format_; }
+
+private:
+    struct Slot
+    {
+        int index = -1;
+        GLsync fence = 0;
+        uint64_t sequence = 0;
+    };
+
+    void run();
+    void retire(Slot &slot);
+
+    CaptureThread &capture_;
+    std::unique_ptr<SharedContext> shared_context_;
+    int width_;
+    int height_;
+    PixelFormat format_;
+    size_t frame_size_;
+
+    std::vector<std::unique_ptr<FrameTextures>> textures_;
+    std::vector<GLuint> pbos_;
+    std::unique_ptr<FrameTextures> blank_;
+
+    SpscQueue<Slot> free_; // render -> worker, fenced on the last draw that read the texture
+    SpscQueue<Slot> ready_; // worker -> render, fenced on the upload
+
+    // render thread only
+    std::vector<Slot> pending_;
+    Slot current_;
+
+    // the slot the worker held when it stopped, only touched again after join()
+    Slot leftover_;
+
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> ended_{false};
+    std::atomic<uint64_t> uploads_{0};
+    std::atomic<uint64_t> upload_ns_{0};
+
+    std::thread thread_;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+
+// Minimal assertions for the test executables. A failed check prints where it failed and carries
+// on, main() returns checkResult() so ctest sees the failure.
+static int check_failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            check_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+    do { \
+        double check_a = (a), check_b = (b); \
+        if (!(std::fabs(check_a - check_b) <= (tolerance))) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_NEAR(" #a ", " #b ") failed, " \
+                << check_a << " vs " << check_b << "\n"; \
+            check_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_THROWS(statement) \
+    do { \
+        bool check_threw = false; \
+        try { \
+            statement; \
+        } catch (const std::exception &) { \
+            check_threw = true; \
+        } \
+        if (!check_threw) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #statement " didn't throw\n"; \
+            check_failures++; \
+        } \
+    } while (0)
+
+inline int checkResult()
+{
+    if (check_failures > 0) {
+        std::cerr << check_failures << " checks failed\n";
+    }
+
+    return check_failures > 0 ? 1 : 0;
+}
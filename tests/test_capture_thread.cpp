@@ -0,0 +1,185 @@
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "capture_thread.hpp"
+#include "check.hpp"
+#include "shm_frame_ring.hpp"
+
+// next() until a frame arrives or a second has passed
+static bool waitForFrame(CaptureThread &capture, Frame &frame)
+{
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+    while (!capture.next(frame)) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return true;
+}
+
+// A producer that pauses for longer than the source's timeout doesn't end the capture
+static void testTimeoutIsNotTheEnd()
+{
+    std::string name = "/opencv_gl_test_" + std::to_string(getpid()) + "_capture";
+    ShmFrameWriter writer(name, 16, 16, PixelFormat::Gray8, 2);
+    CaptureThread capture(std::unique_ptr<FrameSource>(new ShmFrameSource(name, 10)), QueuePolicy::Fifo);
+
+    Frame frame;
+    CHECK(writer.acquire() != nullptr);
+    writer.publish(steadyNanoseconds());
+
+    CHECK(waitForFrame(capture, frame));
+    CHECK(frame.sequence == 0);
+    capture.release(frame);
+
+    // ten timeouts of the source
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(!capture.finished());
+
+    CHECK(writer.acquire() != nullptr);
+    writer.publish(steadyNanoseconds());
+
+    CHECK(waitForFrame(capture, frame));
+    CHECK(frame.sequence == 1);
+    capture.release(frame);
+
+    CHECK(!capture.finished());
+}
+
+// A file sequence ends after its last frame, each stamped on the steady clock
+static void testEndOfFiles()
+{
+    char dir[] = "/tmp/opencv_gl_test_XXXXXX";
+    CHECK(mkdtemp(dir) != nullptr);
+
+    for (int i = 0; i < 3; i++) {
+        std::ofstream file(std::string(dir) + "/" + std::to_string(i) + ".pgm", std::ios::binary);
+        file << "P5\n4 2\n255\n" << std::string(8, static_cast<char>(i));
+    }
+
+    int64_t start_ns = steadyNanoseconds();
+
+    {
+        CaptureThread capture(std::unique_ptr<FrameSource>(new FileSequenceFrameSource(dir, false, 1000)), QueuePolicy::Fifo);
+
+        Frame frame;
+        uint64_t frames = 0;
+        int64_t last_ns = start_ns;
+
+        while (frames < 3 && waitForFrame(capture, frame)) {
+            CHECK(frame.sequence == frames);
+            CHECK(frame.data[0] == frames);
+            CHECK(frame.timestamp_ns >= last_ns && frame.timestamp_ns <= steadyNanoseconds());
+
+            last_ns = frame.timestamp_ns;
+            frames++;
+            capture.release(frame);
+        }
+
+        CHECK(frames == 3);
+
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+        while (!capture.finished() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        CHECK(capture.finished());
+        CHECK(!capture.next(frame));
+    }
+
+    for (int i = 0; i < 3; i++) {
+        std::remove((std::string(dir) + "/" + std::to_string(i) + ".pgm").c_str());
+    }
+
+    rmdir(dir);
+}
+
+// With fill_in_place the frames come back in the lent buffers, in the order they were lent
+static void testFillInPlace()
+{
+    char dir[] = "/tmp/opencv_gl_test_XXXXXX";
+    CHECK(mkdtemp(dir) != nullptr);
+
+    for (int i = 0; i < 3; i++) {
+        std::ofstream file(std::string(dir) + "/" + std::to_string(i) + ".pgm", std::ios::binary);
+        file << "P5\n4 2\n255\n" << std::string(8, static_cast<char>(i + 1));
+    }
+
+    {
+        CaptureThread capture(std::unique_ptr<FrameSource>(new FileSequenceFrameSource(dir, false, 1000)), QueuePolicy::Fifo, 2, true);
+        CHECK(capture.fillsInPlace());
+
+        std::vector<unsigned char> buffers[3] = {std::vector<unsigned char>(8), std::vector<unsigned char>(8),
+            std::vector<unsigned char>(8)};
+
+        CHECK(capture.provide(buffers[0].data()));
+        CHECK(capture.provide(buffers[1].data()));
+
+        Frame frame;
+
+        for (int i = 0; i < 3; i++) {
+            CHECK(waitForFrame(capture, frame));
+            CHECK(frame.data == buffers[i % 3].data());
+            CHECK(frame.sequence == static_cast<uint64_t>(i));
+            CHECK(frame.width == 4 && frame.height == 2 && frame.stride == 4);
+            CHECK(buffers[i % 3][0] == i + 1 && buffers[i % 3][7] == i + 1);
+            capture.release(frame);
+
+            CHECK(capture.provide(buffers[(i + 2) % 3].data()));
+        }
+
+        // nothing is written into the buffers still lent after the end
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+        while (!capture.finished() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        CHECK(capture.finished());
+        capture.stop();
+    }
+
+    // the synthetic source writes what generate() does
+    {
+        SyntheticFrameSource source(64, 32, PixelFormat::NV12);
+        CaptureThread capture(std::unique_ptr<FrameSource>(new SyntheticFrameSource(64, 32, PixelFormat::NV12)),
+            QueuePolicy::Latest, 4, true);
+
+        std::vector<unsigned char> buffer(64 * 32 * 3 / 2), expected(buffer.size());
+        CHECK(capture.provide(buffer.data()));
+
+        Frame frame;
+        CHECK(waitForFrame(capture, frame));
+        CHECK(frame.data == buffer.data());
+        source.generate(expected.data(), frame.sequence);
+        CHECK(buffer == expected);
+        capture.release(frame);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        std::remove((std::string(dir) + "/" + std::to_string(i) + ".pgm").c_str());
+    }
+
+    rmdir(dir);
+}
+
+int main()
+{
+    testTimeoutIsNotTheEnd();
+    testEndOfFiles();
+    testFillInPlace();
+
+    return checkResult();
+}
@@ -0,0 +1,115 @@
+#include <string>
+
+#include "calibration_io.hpp"
+#include "check.hpp"
+#include "opencv_storage.hpp"
+
+static const std::string DATA_DIR = TEST_DATA_DIR;
+
+// The output of OpenCV's calibration sample
+static void testCalibrationYaml()
+{
+    OpenCVStorage storage = OpenCVStorage::load(DATA_DIR + "/calibration.yml");
+
+    CHECK(storage.node("calibration_time", StorageNode::String).text == "Sat Oct 17 10:21:03 2026");
+    CHECK(storage.number("image_width", 0) == 640);
+    CHECK(storage.number("flags", 0) == 4);
+    CHECK(storage.number("square_size", 0) == 2.0000000298023224e-02);
+    CHECK(storage.number("missing", -1) == -1);
+
+    const StorageNode &camera_matrix = storage.node("camera_matrix", StorageNode::Matrix);
+    CHECK(camera_matrix.rows == 3 && camera_matrix.cols == 3);
+    CHECK(camera_matrix.values.size() == 9);
+    CHECK(camera_matrix.values[0] == 5.3646257838368388e+02);
+    CHECK(camera_matrix.values[5] == 2.3554895272852343e+02);
+    CHECK(camera_matrix.values[8] == 1);
+
+    const StorageNode &extrinsics = storage.node("extrinsic_parameters", StorageNode::Matrix);
+    CHECK(extrinsics.rows == 3 && extrinsics.cols == 6);
+    CHECK(extrinsics.values.size() == 18);
+    CHECK(extrinsics.values[7] == 1.0471975511965976e+00);
+    CHECK(extrinsics.values[17] == 0.5);
+
+    // 2 channels per element
+    const StorageNode &image_points = storage.node("image_points", StorageNode::Matrix);
+    CHECK(image_points.rows == 3 && image_points.cols == 4);
+    CHECK(image_points.values.size() == 12);
+    CHECK(image_points.values[11] == 8.47925949e+01);
+
+    const StorageNode &grid_points = storage.node("grid_points", StorageNode::Sequence);
+    CHECK(grid_points.items == 6);
+    CHECK(grid_points.values.size() == 6);
+    CHECK(grid_points.values[3] == 2.00000003e-02);
+
+    CHECK(storage.find("missing") == nullptr);
+    CHECK_THROWS(storage.node("missing", StorageNode::Matrix));
+    CHECK_THROWS(storage.node("image_width", StorageNode::Matrix));
+}
+
+// rvecs and tvecs written from std::vector<cv::Mat> and std::vector<cv::Vec3d>
+static void testSequences()
+{
+    OpenCVStorage yaml = OpenCVStorage::load(DATA_DIR + "/poses.yml");
+    OpenCVStorage xml = OpenCVStorage::load(DATA_DIR + "/poses.xml");
+    OpenCVStorage calibration = OpenCVStorage::load(DATA_DIR + "/calibration.xml");
+
+    for (const OpenCVStorage *storage : {&yaml, &xml, &calibration}) {
+        const StorageNode &rvecs = storage->node("rvecs", StorageNode::Sequence);
+        const StorageNode &tvecs = storage->node("tvecs", StorageNode::Sequence);
+
+        CHECK(rvecs.items == 3 && rvecs.values.size() == 9);
+        CHECK(tvecs.items == 3 && tvecs.values.size() == 9);
+        CHECK(rvecs.values[4] == 1.0471975511965976e+00);
+        CHECK(rvecs.values[6] == 6.4350110879328437e-01);
+        CHECK(tvecs.values[0] == -0.05);
+        CHECK(tvecs.values[8] == 0.5);
+    }
+}
+
+static void testMalformed()
+{
+    // fewer numbers than rows x cols
+    CHECK_THROWS(OpenCVStorage::parse("%YAML:1.0\n---\nm: !!opencv-matrix\n   rows: 2\n   cols: 2\n   dt: d\n   data: [ 1, 2, 3 ]\n"));
+    CHECK_THROWS(OpenCVStorage::parse("<?xml version=\"1.0\"?>\n<opencv_storage>\n<m type_id=\"opencv-matrix\">\n"
+        "  <rows>2</rows>\n  <cols>2</cols>\n  <dt>d</dt>\n  <data>\n    1 2 3</data></m>\n</opencv_storage>\n"));
+
+    // unterminated
+    CHECK_THROWS(OpenCVStorage::parse("<?xml version=\"1.0\"?>\n<opencv_storage>\n<a>1</a>\n"));
+    CHECK_THROWS(OpenCVStorage::load(DATA_DIR + "/missing.yml"));
+}
+
+// The same calibration in YAML and XML
+static void testLoadCalibration()
+{
+    CameraModel yaml = loadCalibration(DATA_DIR + "/calibration.yml");
+    CameraModel xml = loadCalibration(DATA_DIR + "/calibration.xml");
+
+    for (const CameraModel *camera : {&yaml, &xml}) {
+        CHECK(camera->width() == 640 && camera->height() == 480);
+        CHECK_NEAR(camera->fx(), 5.3646257838368388e+02, 1e-4);
+        CHECK_NEAR(camera->fy(), 5.3641495077527384e+02, 1e-4);
+        CHECK_NEAR(camera->cx(), 3.4236864003069093e+02, 1e-4);
+        CHECK_NEAR(camera->cy(), 2.3554895272852343e+02, 1e-4);
+        CHECK(camera->skew() == 0);
+
+        const DistortionCoeffs &distortion = camera->distortion();
+        CHECK_NEAR(distortion.k1, -2.6637260909660682e-01, 1e-7);
+        CHECK_NEAR(distortion.k2, -3.8588898922304653e-02, 1e-7);
+        CHECK_NEAR(distortion.p1, 1.7831947042852964e-03, 1e-7);
+        CHECK_NEAR(distortion.p2, -2.8122100441115472e-04, 1e-7);
+        CHECK_NEAR(distortion.k3, 2.3839153080878486e-01, 1e-7);
+    }
+
+    // a pose file has no camera_matrix
+    CHECK_THROWS(loadCalibration(DATA_DIR + "/poses.yml"));
+}
+
+int main()
+{
+    testCalibrationYaml();
+    testSequences();
+    testMalformed();
+    testLoadCalibration();
+
+    return checkResult();
+}
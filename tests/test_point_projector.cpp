@@ -0,0 +1,145 @@
+#include <cstring>
+#include <vector>
+
+#include "check.hpp"
+#include "point_projector.hpp"
+
+struct Points
+{
+    std::vector<float> x, y, z;
+};
+
+// In front of the camera, with the model below, spread over a few metres
+static Points makePoints(size_t count)
+{
+    Points points;
+    unsigned int seed = 1;
+
+    auto rand01 = [&seed]() {
+        seed = seed*1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+
+    for (size_t i = 0; i < count; i++) {
+        points.x.push_back(rand01() - 0.5f);
+        points.y.push_back(rand01() - 0.5f);
+        points.z.push_back(rand01() * 2.0f);
+    }
+
+    return points;
+}
+
+// rotation about z by 30 degrees and 1 m forward
+static glm::mat4 makeModel()
+{
+    // NOTE: glm is column first then row
+    glm::mat4 model(1.0);
+    model[0][0] = 0.8660254f;
+    model[0][1] = 0.5f;
+    model[1][0] = -0.5f;
+    model[1][1] = 0.8660254f;
+    model[3][0] = 0.1f;
+    model[3][1] = -0.05f;
+    model[3][2] = 1.0f;
+
+    return model;
+}
+
+// The scalar path against the formula in point_projector.hpp, in double
+static void testClosedForm()
+{
+    const float fx = 530.0f, fy = 531.5f, cx = 320.5f, cy = 241.0f, skew = 0.5f;
+    glm::mat4 model = makeModel();
+
+    PointProjector projector(fx, fy, cx, cy, model);
+    projector.setCamera(fx, fy, cx, cy, skew);
+    projector.setSimdLevel(SimdLevel::Scalar);
+
+    Points points = makePoints(1000);
+    std::vector<float> u(1000), v(1000), depth(1000);
+    projector.project(points.x.data(), points.y.data(), points.z.data(), 1000, u.data(), v.data(), depth.data());
+
+    for (size_t i = 0; i < 1000; i++) {
+        double p[3];
+
+        for (int row = 0; row < 3; row++) {
+            p[row] = model[0][row]*points.x[i] + model[1][row]*points.y[i] + model[2][row]*points.z[i] + model[3][row];
+        }
+
+        CHECK_NEAR(u[i], (fx*p[0] + skew*p[1] + cx*p[2]) / p[2], 1e-3);
+        CHECK_NEAR(v[i], (fy*p[1] + cy*p[2]) / p[2], 1e-3);
+        CHECK_NEAR(depth[i], p[2], 1e-5);
+    }
+}
+
+// Every supported level gives the same bits as scalar, including the tails shorter than a register
+static void testSimdMatchesScalar()
+{
+    PointProjector projector(530.0f, 531.5f, 320.5f, 241.0f, makeModel());
+    projector.setCamera(530.0f, 531.5f, 320.5f, 241.0f, 0.5f);
+
+    const size_t counts[] = {0, 1, 3, 4, 7, 8, 9, 15, 17, 1005};
+
+    for (size_t count : counts) {
+        Points points = makePoints(count);
+        std::vector<float> u_scalar(count + 1), v_scalar(count + 1), depth_scalar(count + 1);
+
+        projector.setSimdLevel(SimdLevel::Scalar);
+        projector.project(points.x.data(), points.y.data(), points.z.data(), count, u_scalar.data(), v_scalar.data(), depth_scalar.data());
+
+        for (SimdLevel level : {SimdLevel::SSE, SimdLevel::AVX2}) {
+            if (!PointProjector::isSupported(level)) {
+                CHECK_THROWS(projector.setSimdLevel(level));
+                continue;
+            }
+
+            // the element past the end must stay untouched
+            std::vector<float> u(count + 1, -1.0f), v(count + 1, -1.0f), depth(count + 1, -1.0f);
+
+            projector.setSimdLevel(level);
+            projector.project(points.x.data(), points.y.data(), points.z.data(), count, u.data(), v.data(), depth.data());
+
+            CHECK(std::memcmp(u.data(), u_scalar.data(), count * sizeof(float)) == 0);
+            CHECK(std::memcmp(v.data(), v_scalar.data(), count * sizeof(float)) == 0);
+            CHECK(std::memcmp(depth.data(), depth_scalar.data(), count * sizeof(float)) == 0);
+            CHECK(u[count] == -1.0f && v[count] == -1.0f && depth[count] == -1.0f);
+
+            // without depth
+            std::vector<float> u2(count + 1), v2(count + 1);
+            projector.project(points.x.data(), points.y.data(), points.z.data(), count, u2.data(), v2.data());
+
+            CHECK(std::memcmp(u2.data(), u_scalar.data(), count * sizeof(float)) == 0);
+            CHECK(std::memcmp(v2.data(), v_scalar.data(), count * sizeof(float)) == 0);
+        }
+    }
+}
+
+static void testParallelMatchesSerial()
+{
+    const size_t count = 200003;
+
+    PointProjector projector(530.0f, 531.5f, 320.5f, 241.0f, makeModel());
+    Points points = makePoints(count);
+
+    std::vector<float> u(count), v(count), depth(count);
+    projector.project(points.x.data(), points.y.data(), points.z.data(), count, u.data(), v.data(), depth.data());
+
+    for (unsigned threads : {1u, 3u, 8u}) {
+        std::vector<float> u_parallel(count), v_parallel(count), depth_parallel(count);
+        projector.projectParallel(points.x.data(), points.y.data(), points.z.data(), count,
+            u_parallel.data(), v_parallel.data(), depth_parallel.data(), threads);
+
+        CHECK(u_parallel == u);
+        CHECK(v_parallel == v);
+        CHECK(depth_parallel == depth);
+    }
+}
+
+int main()
+{
+    testClosedForm();
+    testSimdMatchesScalar();
+    testParallelMatchesSerial();
+
+    return checkResult();
+}
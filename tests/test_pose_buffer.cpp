@@ -0,0 +1,155 @@
+#include <cmath>
+
+#include "check.hpp"
+#include "pose_buffer.hpp"
+
+static const double PI = std::acos(-1.0);
+
+// Rotation about z by degrees and a translation along x
+static glm::mat4 makePose(double degrees, float x)
+{
+    double angle = degrees * PI / 180;
+
+    // NOTE: glm is column first then row
+    glm::mat4 pose(1.0);
+    pose[0][0] = std::cos(angle);
+    pose[0][1] = std::sin(angle);
+    pose[1][0] = -std::sin(angle);
+    pose[1][1] = std::cos(angle);
+    pose[3][0] = x;
+
+    return pose;
+}
+
+static void checkPose(const glm::mat4 &pose, const glm::mat4 &expected)
+{
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            CHECK_NEAR(pose[col][row], expected[col][row], 1e-5);
+        }
+    }
+}
+
+static void checkSample(const PoseBuffer &buffer, int64_t timestamp_ns, const glm::mat4 &expected)
+{
+    glm::mat4 pose;
+    CHECK(buffer.sample(timestamp_ns, pose));
+    checkPose(pose, expected);
+}
+
+static void testEmptyAndSingle()
+{
+    PoseBuffer buffer;
+    glm::mat4 pose;
+
+    CHECK(!buffer.sample(0, pose));
+    CHECK(buffer.size() == 0);
+
+    buffer.push(1000, makePose(30, 1));
+
+    int64_t newest_ns = 0;
+    CHECK(buffer.sample(0, pose, &newest_ns));
+    CHECK(newest_ns == 1000);
+    checkPose(pose, makePose(30, 1));
+
+    // one pose has no velocity to extrapolate with
+    checkSample(buffer, 5000, makePose(30, 1));
+}
+
+// 90 degrees and 1 m over 1000 ns
+static void testInterpolation()
+{
+    PoseBuffer buffer;
+    buffer.push(1000, makePose(0, 0));
+    buffer.push(2000, makePose(90, 1));
+    buffer.push(3000, makePose(100, 3));
+
+    checkSample(buffer, 1000, makePose(0, 0));
+    checkSample(buffer, 1500, makePose(45, 0.5f));
+    checkSample(buffer, 1250, makePose(22.5, 0.25f));
+    checkSample(buffer, 2000, makePose(90, 1));
+    checkSample(buffer, 2500, makePose(95, 2));
+    checkSample(buffer, 3000, makePose(100, 3));
+
+    // before the oldest pose it is returned as is
+    checkSample(buffer, 0, makePose(0, 0));
+    checkSample(buffer, -1000000, makePose(0, 0));
+}
+
+// Past the newest pose it continues with the last velocity, for at most max_extrapolation_ns
+static void testExtrapolation()
+{
+    PoseBuffer buffer(64, 2000);
+    buffer.push(0, makePose(0, 5));
+    buffer.push(1000, makePose(10, 0));
+    buffer.push(2000, makePose(40, 1));
+
+    int64_t newest_ns = 0;
+    glm::mat4 pose;
+    CHECK(buffer.sample(2500, pose, &newest_ns));
+    CHECK(newest_ns == 2000);
+    checkPose(pose, makePose(55, 1.5f));
+
+    checkSample(buffer, 4000, makePose(100, 3));
+
+    // clamped to 2000 ns past the newest pose
+    checkSample(buffer, 5000, makePose(100, 3));
+    checkSample(buffer, 1000000000, makePose(100, 3));
+}
+
+// 170 to 190 degrees takes the short way through 180, not back through 0
+static void testAcrossPi()
+{
+    PoseBuffer buffer;
+    buffer.push(0, makePose(170, 0));
+    buffer.push(1000, makePose(-170, 0));
+
+    checkSample(buffer, 500, makePose(180, 0));
+    checkSample(buffer, 250, makePose(175, 0));
+    checkSample(buffer, 2000, makePose(210, 0));
+}
+
+static void testOrderAndCapacity()
+{
+    PoseBuffer buffer(4);
+    buffer.push(1000, makePose(10, 1));
+
+    // not newer than the newest, dropped
+    buffer.push(1000, makePose(20, 2));
+    buffer.push(500, makePose(30, 3));
+    CHECK(buffer.size() == 1);
+    checkSample(buffer, 1000, makePose(10, 1));
+
+    for (int i = 2; i <= 10; i++) {
+        buffer.push(i * 1000, makePose(i * 10, i));
+    }
+
+    // the oldest poses went, 7 to 10 are left
+    CHECK(buffer.size() == 4);
+    checkSample(buffer, 0, makePose(70, 7));
+    checkSample(buffer, 9500, makePose(95, 9.5f));
+
+    buffer.clear();
+    glm::mat4 pose;
+    CHECK(buffer.size() == 0);
+    CHECK(!buffer.sample(0, pose));
+
+    // at least two poses to interpolate between
+    PoseBuffer small(0);
+    small.push(0, makePose(0, 0));
+    small.push(1000, makePose(10, 1));
+    small.push(2000, makePose(20, 2));
+    CHECK(small.size() == 2);
+    checkSample(small, 1500, makePose(15, 1.5f));
+}
+
+int main()
+{
+    testEmptyAndSingle();
+    testInterpolation();
+    testExtrapolation();
+    testAcrossPi();
+    testOrderAndCapacity();
+
+    return checkResult();
+}
@@ -0,0 +1,237 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "pose_io.hpp"
+
+static const std::string DATA_DIR = TEST_DATA_DIR;
+
+// The three poses of the sample files: no rotation, 60 degrees about y, and about x with a
+// cosine of 0.8
+static glm::mat4 expectedPose(int i)
+{
+    // NOTE: glm is column first then row
+    glm::mat4 pose(1.0);
+
+    if (i == 0) {
+        pose[3] = glm::vec4(-0.05, -0.05, 0.2, 1);
+    } else if (i == 1) {
+        pose[0][0] = 0.5f;
+        pose[0][2] = -0.8660254f;
+        pose[2][0] = 0.8660254f;
+        pose[2][2] = 0.5f;
+        pose[3] = glm::vec4(0.01, 0.02, 0.3, 1);
+    } else {
+        pose[1][1] = 0.8f;
+        pose[1][2] = 0.6f;
+        pose[2][1] = -0.6f;
+        pose[2][2] = 0.8f;
+        pose[3] = glm::vec4(-0.08, -0.02, 0.5, 1);
+    }
+
+    return pose;
+}
+
+static void checkPose(const glm::mat4 &pose, const glm::mat4 &expected)
+{
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            CHECK_NEAR(pose[col][row], expected[col][row], 1e-6);
+        }
+    }
+}
+
+static void checkPoses(const std::vector<glm::mat4> &poses)
+{
+    CHECK(poses.size() == 3);
+
+    for (size_t i = 0; i < poses.size() && i < 3; i++) {
+        checkPose(poses[i], expectedPose(i));
+    }
+}
+
+// extrinsic_parameters, rvecs and tvecs as matrices and as sequences, YAML and XML
+static void testStorageFiles()
+{
+    checkPoses(loadPoses(DATA_DIR + "/calibration.yml"));
+    checkPoses(loadPoses(DATA_DIR + "/calibration.xml"));
+    checkPoses(loadPoses(DATA_DIR + "/poses.yml"));
+    checkPoses(loadPoses(DATA_DIR + "/poses.xml"));
+
+    // solvePnP, a single rvec and tvec
+    std::vector<glm::mat4> pnp = loadPoses(DATA_DIR + "/pnp.yml");
+    CHECK(pnp.size() == 1);
+
+    if (!pnp.empty()) {
+        checkPose(pnp[0], expectedPose(1));
+    }
+
+    CHECK_THROWS(loadPoses(DATA_DIR + "/missing.yml"));
+}
+
+static void writeFile(const std::string &filename, const std::string &content)
+{
+    std::ofstream file(filename, std::ios::binary);
+    file << content;
+}
+
+static std::string readFile(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// CSV and raw binary records of the same poses
+static void testRecordFiles(const std::string &dir)
+{
+    std::string csv = "# r00 r01 r02 r10 r11 r12 r20 r21 r22 tx ty tz\n";
+    std::vector<double> records;
+
+    for (int i = 0; i < 3; i++) {
+        glm::mat4 pose = expectedPose(i);
+
+        for (int row = 0; row < 3; row++) {
+            for (int col = 0; col < 3; col++) {
+                records.push_back(pose[col][row]);
+            }
+        }
+
+        for (int row = 0; row < 3; row++) {
+            records.push_back(pose[3][row]);
+        }
+
+        for (size_t k = records.size() - 12; k < records.size(); k++) {
+            csv += std::to_string(records[k]) + (k % 12 == 11 ? "\n" : ", ");
+        }
+    }
+
+    writeFile(dir + "/poses.csv", csv);
+    writeFile(dir + "/poses.bin", std::string(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(double)));
+    writeFile(dir + "/truncated.bin", std::string(reinterpret_cast<const char*>(records.data()), 100));
+    writeFile(dir + "/short.csv", "1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0\n");
+
+    checkPoses(loadPoses(dir + "/poses.csv"));
+    checkPoses(loadPoses(dir + "/poses.bin"));
+    CHECK_THROWS(loadPoses(dir + "/truncated.bin"));
+    CHECK_THROWS(loadPoses(dir + "/short.csv"));
+
+    for (const char *name : {"poses.csv", "poses.bin", "truncated.bin", "short.csv"}) {
+        std::remove((dir + "/" + name).c_str());
+    }
+}
+
+static std::vector<std::string> listFiles(const std::string &dir)
+{
+    std::vector<std::string> files;
+    DIR *d = opendir(dir.c_str());
+
+    if (!d) {
+        return files;
+    }
+
+    while (dirent *entry = readdir(d)) {
+        if (entry->d_name[0] != '.') {
+            files.push_back(dir + "/" + entry->d_name);
+        }
+    }
+
+    closedir(d);
+
+    return files;
+}
+
+// Overwrite the tx of the first cached pose, the cache ends with the 3 poses as glm::mat4
+static void tamperCache(const std::string &cache_file, float tx)
+{
+    std::fstream file(cache_file, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(0, std::ios::end);
+    file.seekp(static_cast<std::streamoff>(file.tellp()) - 3 * sizeof(glm::mat4) + 12 * sizeof(float));
+    file.write(reinterpret_cast<const char*>(&tx), sizeof(tx));
+}
+
+// First load writes the cache, later ones read it until the source changes
+static void testPoseCache(const std::string &dir)
+{
+    std::string source = dir + "/poses.yml";
+    std::string cache_dir = dir + "/cache/poses";
+    writeFile(source, readFile(DATA_DIR + "/poses.yml"));
+
+    setPoseCache(cache_dir);
+
+    checkPoses(loadPoses(source));
+
+    std::vector<std::string> cached = listFiles(cache_dir);
+    CHECK(cached.size() == 1);
+
+    if (cached.size() != 1) {
+        setPoseCache("");
+        return;
+    }
+
+    // the second load comes from the cache, so it sees the change
+    tamperCache(cached[0], 42);
+    std::vector<glm::mat4> poses = loadPoses(source);
+    CHECK(poses.size() == 3 && poses[0][3][0] == 42.0f);
+
+    // a new modification time makes it parse the source again
+    struct timespec times[2] = {{0, UTIME_OMIT}, {1000000000, 0}};
+    CHECK(utimensat(AT_FDCWD, source.c_str(), times, 0) == 0);
+    checkPoses(loadPoses(source));
+    checkPoses(loadPoses(source));
+
+    // and so does a new size
+    tamperCache(cached[0], 42);
+    writeFile(source, readFile(DATA_DIR + "/poses.yml") + "# appended\n");
+    CHECK(utimensat(AT_FDCWD, source.c_str(), times, 0) == 0);
+    checkPoses(loadPoses(source));
+
+    // a truncated cache is parsed again and replaced
+    writeFile(cached[0], readFile(cached[0]).substr(0, 40));
+    checkPoses(loadPoses(source));
+    CHECK(readFile(cached[0]).size() > 40);
+
+    // so is one whose count doesn't match its size, rather than allocating the count
+    std::string cache = readFile(cached[0]);
+    uint64_t count = 1ull << 60;
+    cache.replace(24, sizeof(count), reinterpret_cast<const char*>(&count), sizeof(count));
+    writeFile(cached[0], cache);
+    checkPoses(loadPoses(source));
+    CHECK(readFile(cached[0]).size() == 32 + 3 * sizeof(glm::mat4));
+
+    // CSV and binary files are never cached
+    testRecordFiles(dir);
+    CHECK(listFiles(cache_dir).size() == 1);
+
+    setPoseCache("");
+
+    // without a cache it parses, even with a tampered cache file around
+    tamperCache(cached[0], 42);
+    checkPoses(loadPoses(source));
+
+    std::remove(cached[0].c_str());
+    std::remove(source.c_str());
+    rmdir(cache_dir.c_str());
+    rmdir((dir + "/cache").c_str());
+}
+
+int main()
+{
+    char dir[] = "/tmp/opencv_gl_test_XXXXXX";
+    CHECK(mkdtemp(dir) != nullptr);
+
+    testStorageFiles();
+    testRecordFiles(dir);
+    testPoseCache(dir);
+
+    rmdir(dir);
+
+    return checkResult();
+}
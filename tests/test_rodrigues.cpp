@@ -0,0 +1,176 @@
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "check.hpp"
+#include "rodrigues.hpp"
+
+// Random rvecs with angles up to a bit over pi and translations of up to a metre
+static std::vector<double> makeVectors(size_t count, double scale)
+{
+    std::vector<double> values;
+    unsigned int seed = 1;
+
+    for (size_t i = 0; i < count * 3; i++) {
+        seed = seed*1664525u + 1013904223u;
+        values.push_back(((seed >> 8) / 16777216.0 - 0.5) * scale);
+    }
+
+    return values;
+}
+
+// The rotation of the unit quaternion (cos(theta/2), sin(theta/2) k), independent of the
+// axis-angle formula in rodrigues.cpp
+static void rotationFromQuaternion(const double rvec[3], double r[9])
+{
+    double theta = std::sqrt(rvec[0]*rvec[0] + rvec[1]*rvec[1] + rvec[2]*rvec[2]);
+    double w = std::cos(theta / 2);
+    double k = theta > 0 ? std::sin(theta / 2) / theta : 0.5;
+    double x = rvec[0] * k, y = rvec[1] * k, z = rvec[2] * k;
+
+    r[0] = 1 - 2*(y*y + z*z);
+    r[1] = 2*(x*y - w*z);
+    r[2] = 2*(x*z + w*y);
+    r[3] = 2*(x*y + w*z);
+    r[4] = 1 - 2*(x*x + z*z);
+    r[5] = 2*(y*z - w*x);
+    r[6] = 2*(x*z - w*y);
+    r[7] = 2*(y*z + w*x);
+    r[8] = 1 - 2*(x*x + y*y);
+}
+
+static void checkRotation(const double rvec[3], double tolerance)
+{
+    double r[9], expected[9];
+    rotationFromRodrigues(rvec, r);
+    rotationFromQuaternion(rvec, expected);
+
+    for (int i = 0; i < 9; i++) {
+        CHECK_NEAR(r[i], expected[i], tolerance);
+    }
+
+    // the axis stays where it is
+    for (int row = 0; row < 3; row++) {
+        CHECK_NEAR(r[row*3]*rvec[0] + r[row*3 + 1]*rvec[1] + r[row*3 + 2]*rvec[2], rvec[row], tolerance);
+    }
+}
+
+static void testClosedForm()
+{
+    std::vector<double> rvecs = makeVectors(1000, 7.0);
+
+    for (size_t i = 0; i < 1000; i++) {
+        checkRotation(&rvecs[i*3], 1e-12);
+    }
+
+    // 90 degrees about each axis
+    const double quarter = std::acos(0.0);
+    const double x[3] = {quarter, 0, 0};
+    const double y[3] = {0, quarter, 0};
+    const double z[3] = {0, 0, quarter};
+    const double rx[9] = {1, 0, 0, 0, 0, -1, 0, 1, 0};
+    const double ry[9] = {0, 0, 1, 0, 1, 0, -1, 0, 0};
+    const double rz[9] = {0, -1, 0, 1, 0, 0, 0, 0, 1};
+    double r[9];
+
+    for (auto axis : {std::make_pair(x, rx), std::make_pair(y, ry), std::make_pair(z, rz)}) {
+        rotationFromRodrigues(axis.first, r);
+
+        for (int i = 0; i < 9; i++) {
+            CHECK_NEAR(r[i], axis.second[i], 1e-15);
+        }
+    }
+}
+
+// Zero, tiny angles where the axis is ill-defined, and half turns
+static void testEdgeCases()
+{
+    const double zero[3] = {0, 0, 0};
+    double r[9];
+    rotationFromRodrigues(zero, r);
+
+    for (int i = 0; i < 9; i++) {
+        CHECK(r[i] == (i % 4 == 0 ? 1 : 0));
+    }
+
+    // I + [rvec]x to first order, below and above the 1e-12 cutoff
+    for (double angle : {1e-15, 1e-13, 1e-11, 1e-9, 1e-6}) {
+        const double rvec[3] = {angle, -2 * angle, 0.5 * angle};
+        checkRotation(rvec, 1e-15);
+
+        // the second order terms are at most |rvec|^2 / 2
+        rotationFromRodrigues(rvec, r);
+        CHECK_NEAR(r[1], -rvec[2], 3 * angle * angle);
+        CHECK_NEAR(r[5], -rvec[0], 3 * angle * angle);
+        CHECK_NEAR(r[6], -rvec[1], 3 * angle * angle);
+    }
+
+    const double pi = std::acos(-1.0);
+    const double half_turn[3] = {pi, 0, 0};
+    rotationFromRodrigues(half_turn, r);
+
+    const double expected[9] = {1, 0, 0, 0, -1, 0, 0, 0, -1};
+
+    for (int i = 0; i < 9; i++) {
+        CHECK_NEAR(r[i], expected[i], 1e-15);
+    }
+
+    const double diagonal[3] = {pi / std::sqrt(3.0), pi / std::sqrt(3.0), pi / std::sqrt(3.0)};
+    checkRotation(diagonal, 1e-14);
+}
+
+// posesFromRodrigues() gives the same bits as poseFromRodrigues() for every thread count,
+// including partial blocks and chunks
+static void testBatched()
+{
+    const size_t count = 100003;
+    std::vector<double> rvecs = makeVectors(count, 7.0);
+    std::vector<double> tvecs = makeVectors(count, 2.0);
+
+    std::vector<glm::mat4> single(count);
+
+    for (size_t i = 0; i < count; i++) {
+        single[i] = poseFromRodrigues(&rvecs[i*3], &tvecs[i*3]);
+    }
+
+    for (size_t i = 0; i < count; i += 997) {
+        double r[9];
+        rotationFromRodrigues(&rvecs[i*3], r);
+
+        // NOTE: glm is column first then row
+        for (int row = 0; row < 3; row++) {
+            for (int col = 0; col < 3; col++) {
+                CHECK_NEAR(single[i][col][row], r[row*3 + col], 1e-6);
+            }
+
+            CHECK_NEAR(single[i][3][row], tvecs[i*3 + row], 1e-6);
+            CHECK(single[i][row][3] == 0);
+        }
+
+        CHECK(single[i][3][3] == 1);
+    }
+
+    const glm::mat4 untouched(-1.0);
+
+    for (unsigned threads : {0u, 1u, 3u, 8u}) {
+        for (size_t n : {size_t(0), size_t(1), size_t(63), size_t(65), count}) {
+            std::vector<glm::mat4> batched(n + 1, untouched);
+            posesFromRodrigues(rvecs.data(), tvecs.data(), n, batched.data(), threads);
+
+            CHECK(std::memcmp(batched.data(), single.data(), n * sizeof(glm::mat4)) == 0);
+
+            // the element past the end must stay untouched
+            CHECK(std::memcmp(&batched[n], &untouched, sizeof(glm::mat4)) == 0);
+        }
+    }
+}
+
+int main()
+{
+    testClosedForm();
+    testEdgeCases();
+    testBatched();
+
+    return checkResult();
+}
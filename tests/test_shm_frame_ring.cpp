@@ -0,0 +1,158 @@
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "shm_frame_ring.hpp"
+
+// unique per run so parallel test runs don't share a ring
+static std::string ringName(const char *suffix)
+{
+    return "/opencv_gl_test_" + std::to_string(getpid()) + "_" + suffix;
+}
+
+static void fill(unsigned char *data, size_t size, uint64_t seed)
+{
+    for (size_t i = 0; i < size; i++) {
+        data[i] = static_cast<unsigned char>(i * 7 + seed);
+    }
+}
+
+static bool matches(const unsigned char *data, size_t size, uint64_t seed)
+{
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] != static_cast<unsigned char>(i * 7 + seed)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void testRoundTrip(PixelFormat format)
+{
+    const int width = 64;
+    const int height = 48;
+    const size_t size = frameSize(format, width, height);
+
+    ShmFrameWriter writer(ringName(pixelFormatName(format)), width, height, format, 3);
+    ShmFrameSource source(ringName(pixelFormatName(format)), 10);
+
+    CHECK(source.width() == width);
+    CHECK(source.height() == height);
+    CHECK(source.format() == format);
+    CHECK(source.maxBorrowed() == 3);
+
+    Frame frame;
+
+    // nothing published yet
+    CHECK(source.acquire(frame) == AcquireResult::Timeout);
+
+    for (uint64_t i = 0; i < 10; i++) {
+        unsigned char *slot = writer.acquire();
+        CHECK(slot != nullptr);
+
+        fill(slot, size, i);
+        writer.publish(1000 + i);
+
+        CHECK(source.acquire(frame) == AcquireResult::Acquired);
+        CHECK(frame.width == width && frame.height == height && frame.format == format);
+        CHECK(frame.stride == writer.stride());
+        CHECK(frame.sequence == i);
+        CHECK(frame.timestamp_ns == static_cast<int64_t>(1000 + i));
+        CHECK(matches(frame.data, size, i));
+
+        source.release(frame);
+    }
+}
+
+// The producer drops frames while every slot is borrowed
+static void testFullRing()
+{
+    ShmFrameWriter writer(ringName("full"), 16, 16, PixelFormat::Gray8, 2);
+    ShmFrameSource source(ringName("full"), 10);
+
+    for (int i = 0; i < 2; i++) {
+        CHECK(writer.acquire() != nullptr);
+        writer.publish(i);
+    }
+
+    CHECK(writer.acquire() == nullptr);
+
+    Frame first, second;
+    CHECK(source.acquire(first) == AcquireResult::Acquired);
+    CHECK(source.acquire(second) == AcquireResult::Acquired);
+    CHECK(first.sequence == 0 && second.sequence == 1);
+    CHECK(first.data != second.data);
+
+    CHECK(writer.acquire() == nullptr);
+
+    source.release(first);
+    CHECK(writer.acquire() != nullptr);
+
+    source.release(second);
+}
+
+static void testMissingRing()
+{
+    CHECK_THROWS(ShmFrameSource(ringName("missing")));
+}
+
+// Producer in another thread as fast as it can, every frame the consumer gets is intact and in order
+static void testConcurrent()
+{
+    const int width = 320;
+    const int height = 240;
+    const size_t size = frameSize(PixelFormat::Gray8, width, height);
+    const uint64_t frames = 2000;
+
+    ShmFrameWriter writer(ringName("concurrent"), width, height, PixelFormat::Gray8, 4);
+    ShmFrameSource source(ringName("concurrent"), 1000);
+
+    std::thread producer([&]() {
+        for (uint64_t i = 0; i < frames; ) {
+            unsigned char *slot = writer.acquire();
+
+            if (!slot) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            fill(slot, size, i);
+            writer.publish(i);
+            i++;
+        }
+    });
+
+    uint64_t received = 0;
+    bool intact = true;
+    Frame frame;
+
+    while (received < frames && source.acquire(frame) == AcquireResult::Acquired) {
+        intact = intact && frame.sequence == received && frame.timestamp_ns == static_cast<int64_t>(received) &&
+            matches(frame.data, size, frame.sequence);
+        received++;
+
+        source.release(frame);
+    }
+
+    producer.join();
+
+    CHECK(received == frames);
+    CHECK(intact);
+}
+
+int main()
+{
+    testRoundTrip(PixelFormat::Gray8);
+    testRoundTrip(PixelFormat::NV12);
+    testRoundTrip(PixelFormat::Gray16);
+    testFullRing();
+    testMissingRing();
+    testConcurrent();
+
+    return checkResult();
+}
@@ -0,0 +1,140 @@
+#include <vector>
+
+#include "check.hpp"
+#include "software_rasterizer.hpp"
+
+// fx = fy = size and the principal point in the middle, so a point at (x, y, z) lands on pixel
+// (size*x/z + size/2, size*y/z + size/2). With power of two sizes and depths the screen
+// coordinates below come out exact and pixel centers lie exactly on the edges.
+static const int SIZE = 64;
+
+static void addVertex(Mesh &mesh, float u, float v, float z, const float color[4])
+{
+    mesh.vertices.push_back((u - SIZE / 2) * z / SIZE);
+    mesh.vertices.push_back((v - SIZE / 2) * z / SIZE);
+    mesh.vertices.push_back(z);
+    mesh.colors.insert(mesh.colors.end(), color, color + 4);
+    mesh.indices.push_back(mesh.indices.size());
+}
+
+static Image render(const Mesh &mesh)
+{
+    SoftwareRasterizer rasterizer(SIZE, SIZE, mesh);
+    rasterizer.setCamera(CameraModel(SIZE, SIZE, SIZE, SIZE, SIZE / 2, SIZE / 2));
+
+    std::vector<unsigned char> black(SIZE * SIZE, 0);
+    Image image;
+    rasterizer.draw(black.data(), SIZE, SIZE, glm::mat4(1.0), SIZE, SIZE, image);
+
+    return image;
+}
+
+static const unsigned char *pixel(const Image &image, int x, int y)
+{
+    return &image.data[(y * image.width + x) * 4];
+}
+
+// The square from pixel center (10.5, 10.5) to (20.5, 20.5) split along its diagonal. The upper
+// right half is opaque red at z = 1, the lower left half green at half alpha in front of it at
+// z = 0.5, so a pixel drawn by both comes out yellowish instead of pure red or dark green.
+static void testSharedEdge()
+{
+    const float red[4] = {1, 0, 0, 1};
+    const float green[4] = {0, 1, 0, 0.5f};
+
+    Mesh mesh;
+    addVertex(mesh, 10.5f, 10.5f, 1, red);
+    addVertex(mesh, 20.5f, 10.5f, 1, red);
+    addVertex(mesh, 20.5f, 20.5f, 1, red);
+    addVertex(mesh, 10.5f, 10.5f, 0.5f, green);
+    addVertex(mesh, 20.5f, 20.5f, 0.5f, green);
+    addVertex(mesh, 10.5f, 20.5f, 0.5f, green);
+
+    Image image = render(mesh);
+    CHECK(image.width == SIZE && image.height == SIZE);
+
+    int red_pixels = 0, green_pixels = 0, both = 0, outside = 0;
+    bool diagonal_red = true;
+
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            const unsigned char *p = pixel(image, x, y);
+            bool in_square = x >= 10 && x < 20 && y >= 10 && y < 20;
+
+            if (p[0] == 255 && p[1] == 0) {
+                red_pixels++;
+            } else if (p[0] == 0 && p[1] >= 127 && p[1] <= 128) {
+                green_pixels++;
+            } else if (p[0] != 0 || p[1] != 0) {
+                both++;
+            }
+
+            // left and top edges are in, right and bottom ones out
+            if (!in_square && (p[0] != 0 || p[1] != 0)) {
+                outside++;
+            }
+
+            // the diagonal is a left edge of the red triangle and a right edge of the green one
+            if (in_square && x == y) {
+                diagonal_red = diagonal_red && p[0] == 255 && p[1] == 0;
+            }
+        }
+    }
+
+    CHECK(both == 0);
+    CHECK(outside == 0);
+    CHECK(red_pixels + green_pixels == 100);
+    CHECK(red_pixels == 55);
+    CHECK(diagonal_red);
+}
+
+// Four triangles around a vertex on a pixel center, every pixel of the square exactly once
+static void testFan()
+{
+    const float colors[4][4] = {{1, 0, 0, 0.5f}, {0, 1, 0, 0.5f}, {0, 0, 1, 0.5f}, {1, 1, 1, 0.5f}};
+    const float corners[5][2] = {{25.5f, 25.5f}, {35.5f, 25.5f}, {35.5f, 35.5f}, {25.5f, 35.5f}, {25.5f, 25.5f}};
+
+    Mesh mesh;
+
+    for (int k = 0; k < 4; k++) {
+        // nearer and nearer so a pixel drawn twice passes the depth test and blends twice
+        float z = 1.0f / (1 << k);
+        addVertex(mesh, 30.5f, 30.5f, z, colors[k]);
+        addVertex(mesh, corners[k][0], corners[k][1], z, colors[k]);
+        addVertex(mesh, corners[k + 1][0], corners[k + 1][1], z, colors[k]);
+    }
+
+    Image image = render(mesh);
+
+    int covered = 0, twice = 0, outside = 0;
+
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            const unsigned char *p = pixel(image, x, y);
+            bool in_square = x >= 25 && x < 35 && y >= 25 && y < 35;
+            int channels = (p[0] != 0) + (p[1] != 0) + (p[2] != 0);
+
+            if (in_square) {
+                covered += channels > 0;
+
+                // one half transparent color over black leaves the others at 0 and itself at about 128,
+                // only the white triangle sets all three
+                twice += !((channels == 1 && (p[0] + p[1] + p[2]) <= 128) || (channels == 3 && p[0] == p[1] && p[1] == p[2] && p[0] <= 128));
+            } else {
+                outside += channels > 0;
+            }
+        }
+    }
+
+    CHECK(covered == 100);
+    CHECK(twice == 0);
+    CHECK(outside == 0);
+}
+
+int main()
+{
+    testSharedEdge();
+    testFan();
+
+    return checkResult();
+}
@@ -0,0 +1,126 @@
+#include <memory>
+#include <thread>
+
+#include "check.hpp"
+#include "spsc_queue.hpp"
+
+static void testCapacity()
+{
+    CHECK(SpscQueue<int>(1).capacity() == 1);
+    CHECK(SpscQueue<int>(3).capacity() == 4);
+    CHECK(SpscQueue<int>(4).capacity() == 4);
+    CHECK(SpscQueue<int>(5).capacity() == 8);
+}
+
+static void testFullAndEmpty()
+{
+    SpscQueue<int> queue(4);
+    int item = -1;
+
+    CHECK(!queue.tryPop(item));
+    CHECK(item == -1);
+
+    for (int i = 0; i < 4; i++) {
+        CHECK(queue.tryPush(i));
+    }
+
+    CHECK(queue.size() == 4);
+    CHECK(!queue.tryPush(4));
+
+    for (int i = 0; i < 4; i++) {
+        CHECK(queue.tryPop(item));
+        CHECK(item == i);
+    }
+
+    CHECK(queue.size() == 0);
+    CHECK(!queue.tryPop(item));
+}
+
+// indices keep counting past the capacity, the slots wrap
+static void testWrapAround()
+{
+    SpscQueue<int> queue(4);
+    int next_push = 0;
+    int next_pop = 0;
+    bool in_order = true;
+
+    for (int round = 0; round < 1000; round++) {
+        // 3 in, 2 out, so the fill level moves and the full case comes up again and again
+        for (int i = 0; i < 3; i++) {
+            if (queue.tryPush(next_push)) {
+                next_push++;
+            }
+        }
+
+        for (int i = 0; i < 2; i++) {
+            int item;
+
+            if (queue.tryPop(item)) {
+                in_order = in_order && item == next_pop;
+                next_pop++;
+            }
+        }
+
+        CHECK(queue.size() == static_cast<size_t>(next_push - next_pop));
+    }
+
+    CHECK(in_order);
+    CHECK(next_push > 1000);
+}
+
+static void testMoveOnly()
+{
+    SpscQueue<std::unique_ptr<int>> queue(2);
+    std::unique_ptr<int> item;
+
+    CHECK(queue.tryPush(std::unique_ptr<int>(new int(7))));
+    CHECK(queue.tryPop(item));
+    CHECK(item && *item == 7);
+}
+
+// One producer and one consumer thread, every item arrives once and in order
+static void testConcurrent()
+{
+    const uint64_t count = 1000000;
+    SpscQueue<uint64_t> queue(64);
+
+    std::thread producer([&]() {
+        for (uint64_t i = 0; i < count; ) {
+            if (queue.tryPush(i)) {
+                i++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint64_t expected = 0;
+    bool in_order = true;
+
+    while (expected < count) {
+        uint64_t item;
+
+        if (queue.tryPop(item)) {
+            in_order = in_order && item == expected;
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    producer.join();
+
+    CHECK(in_order);
+    CHECK(queue.size() == 0);
+}
+
+int main()
+{
+    testCapacity();
+    testFullAndEmpty();
+    testWrapAround();
+    testMoveOnly();
+    testConcurrent();
+
+    return checkResult();
+}